@@ -0,0 +1,204 @@
+/**
+ * \file
+ * \brief Implementation of the inverse ballistics of the rocket
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "AimSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <corecrt_math_defines.h>
+#include <limits>
+#include <memory>
+
+#include "SaluteGun.h"
+
+
+namespace weapons
+{
+
+namespace
+{
+
+const float NO_VALUE = std::numeric_limits<float>::quiet_NaN();
+
+// Trajectory is integrated while it is above the muzzle, but not longer than this number of steps
+const int MAX_FLIGHT_STEPS = 100000;
+
+// Elevations of the chord, which differ more, are not the solution
+const float MAX_RESIDUAL = 0.5f;
+
+// Steep trajectories come back to the muzzle after the top, so the distance of the top is passed
+// again only on the fall far away. Neighbouring cells, which differ more, are split by this jump
+// and are not interpolated.
+const float MAX_CELL_SPREAD = 5.0f;
+
+float ToDegrees(float angle)
+{
+    return static_cast<float>(angle * PI_DEGREES / M_PI);
+}
+
+}
+
+const AimSolver& AimSolver::Instance(RocketKindId kind)
+{
+    static std::unique_ptr<const AimSolver> solvers[ROCKET_KIND_COUNT];
+    auto& solver = solvers[kind];
+    if (!solver)
+        solver.reset(new AimSolver(kind));
+    return *solver;
+}
+
+AimSolver::AimSolver(RocketKindId kind)
+    : mAngles(static_cast<int>(std::lround((AIM_MAX_ANGLE - AIM_MIN_ANGLE) / AIM_ANGLE_STEP)) + 1),
+    mDistances(static_cast<int>(std::lround(AIM_MAX_DISTANCE / AIM_DISTANCE_STEP)) + 1),
+    mElevations(static_cast<int>(std::lround(PI_DEGREES / AIM_ELEVATION_STEP)) + 1),
+    mForward(mAngles * mDistances, NO_VALUE),
+    mInverse(mDistances * mElevations, NO_VALUE)
+{
+    for (int row = 0; row < mAngles; row++)
+        BuildRow(kind, row);
+    for (int column = 0; column < mDistances; column++)
+        BuildColumn(column);
+}
+
+void AimSolver::BuildRow(RocketKindId kind, int row)
+{
+    // The same Runge - Kutta step as the simulation, but from the origin and without wind
+    const float time_delta = 10.0f / SIMULATION_RATE;
+    float angle = AIM_MIN_ANGLE + row * AIM_ANGLE_STEP;
+    float radians = static_cast<float>(angle * M_PI / PI_DEGREES);
+    int velocity = ROCKET_KINDS[kind].mVelocity;
+    float xy[N_DIM] = { 0.0f, velocity * std::cos(radians), 0.0f, velocity * std::sin(radians) };
+
+    float* elevations = mForward.data() + row * mDistances;
+    elevations[0] = angle;
+    int column = 1;
+    float prev_x = 0.0f;
+    float prev_y = 0.0f;
+    float prev_distance = 0.0f;
+    for (int step = 0; step < MAX_FLIGHT_STEPS && column < mDistances && xy[2] >= 0.0f; step++)
+    {
+        float k[Rocket::RK_STAGES][N_DIM];
+        float stage[N_DIM];
+        static const float STAGE_STEP[Rocket::RK_STAGES] = { 0.0f, 0.5f, 0.5f, 1.0f };
+        for (int s = 0; s < Rocket::RK_STAGES; s++)
+        {
+            for (int i = 0; i < N_DIM; i++)
+                stage[i] = s ? xy[i] + STAGE_STEP[s] * time_delta * k[s - 1][i] : xy[i];
+            Rocket::RKFunc(kind, stage, 0.0f, 0.0f, k[s]);
+        }
+        for (int i = 0; i < N_DIM; i++)
+            xy[i] += time_delta * (k[0][i] + 2.0 * k[1][i] + 2.0 * k[2][i] + k[3][i]) / 6.0;
+
+        // The rocket bursts, when it passes the distance first time
+        float distance = std::sqrt(xy[0] * xy[0] + xy[2] * xy[2]);
+        for (; column < mDistances && column * AIM_DISTANCE_STEP <= distance; column++)
+        {
+            float t = (column * AIM_DISTANCE_STEP - prev_distance) / (distance - prev_distance);
+            float x = prev_x + t * (xy[0] - prev_x);
+            float y = prev_y + t * (xy[2] - prev_y);
+            elevations[column] = ToDegrees(std::atan2(y, x));
+        }
+        prev_x = xy[0];
+        prev_y = xy[2];
+        prev_distance = std::max(prev_distance, distance);
+    }
+}
+
+void AimSolver::BuildColumn(int column)
+{
+    // Elevation grows with the launch angle, so the angle of the elevation is in the first
+    // pair of the neighbouring rows, which contains it
+    float* angles = mInverse.data() + column * mElevations;
+    for (int index = 0; index < mElevations; index++)
+    {
+        float elevation = index * AIM_ELEVATION_STEP;
+        for (int row = 0; row + 1 < mAngles; row++)
+        {
+            float low = mForward[row * mDistances + column];
+            float high = mForward[(row + 1) * mDistances + column];
+            if (std::isnan(low) || std::isnan(high) || low == high ||
+                std::fabs(high - low) > MAX_CELL_SPREAD ||
+                elevation < std::min(low, high) || elevation > std::max(low, high))
+                continue;
+
+            angles[index] = AIM_MIN_ANGLE + (row + (elevation - low) / (high - low)) * AIM_ANGLE_STEP;
+            break;
+        }
+    }
+}
+
+float AimSolver::Elevation(int row, float distance) const
+{
+    float position = distance / AIM_DISTANCE_STEP;
+    int column = std::min(static_cast<int>(position), mDistances - 2);
+    float t = position - column;
+    const float* elevations = mForward.data() + row * mDistances;
+    if (std::fabs(elevations[column + 1] - elevations[column]) > MAX_CELL_SPREAD)
+        return NO_VALUE;
+    return elevations[column] + t * (elevations[column + 1] - elevations[column]);
+}
+
+bool AimSolver::Solve(float dx, float dy, float& angle, float& distance) const
+{
+    float target_distance = std::sqrt(dx * dx + dy * dy);
+    if (dy < 0.0f || target_distance >= AIM_MAX_DISTANCE)
+        return false;
+    float target_elevation = ToDegrees(std::atan2(dy, dx));
+
+    // Initial angle by the inverse table. Cells on the border of the reachable area
+    // have no value in some corners, so only the known corners are interpolated.
+    float row_position = target_distance / AIM_DISTANCE_STEP;
+    float column_position = target_elevation / AIM_ELEVATION_STEP;
+    int row = std::min(static_cast<int>(row_position), mDistances - 2);
+    int column = std::min(static_cast<int>(column_position), mElevations - 2);
+    float tr = row_position - row;
+    float tc = column_position - column;
+    float sum = 0.0f;
+    float weight_sum = 0.0f;
+    for (int corner = 0; corner < 4; corner++)
+    {
+        int dr = corner >> 1;
+        int dc = corner & 1;
+        float value = mInverse[(row + dr) * mElevations + column + dc];
+        float weight = (dr ? tr : 1.0f - tr) * (dc ? tc : 1.0f - tc);
+        if (std::isnan(value) || weight <= 0.0f)
+            continue;
+        sum += weight * value;
+        weight_sum += weight;
+    }
+    if (weight_sum <= 0.0f)
+        return false;
+    float solution = sum / weight_sum;
+
+    // Newton iterations on the forward table: the elevation is linear in every angle cell,
+    // so the derivative is the slope of the cell
+    float residual = 0.0f;
+    for (int iteration = 0; iteration <= AIM_NEWTON_STEPS; iteration++)
+    {
+        float position = (solution - AIM_MIN_ANGLE) / AIM_ANGLE_STEP;
+        int angle_row = std::max(0, std::min(static_cast<int>(position), mAngles - 2));
+        float low = Elevation(angle_row, target_distance);
+        float high = Elevation(angle_row + 1, target_distance);
+        if (std::isnan(low) || std::isnan(high) || std::fabs(high - low) > MAX_CELL_SPREAD)
+            return false;
+
+        residual = low + (position - angle_row) * (high - low) - target_elevation;
+        if (std::fabs(residual) < AIM_TOLERANCE || iteration == AIM_NEWTON_STEPS || low == high)
+            break;
+        solution -= residual * AIM_ANGLE_STEP / (high - low);
+        solution = std::max(AIM_MIN_ANGLE, std::min(solution, AIM_MAX_ANGLE));
+    }
+    if (std::fabs(residual) > MAX_RESIDUAL)
+        return false;
+
+    angle = solution;
+    distance = target_distance;
+    return true;
+}
+
+}
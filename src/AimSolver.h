@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Inverse ballistics of the rocket: launch angle and burst distance for the target point
+ * \author Maksimovskiy A.S.
+ */
+
+#include <vector>
+
+#include "Params.h"
+#include "RocketKinds.h"
+
+
+namespace weapons
+{
+
+// Solution of the flight in calm air for one rocket kind.
+// Trajectories of all launch angles are integrated once by the simulation step.
+// The forward table keeps the elevation of the chord from the muzzle, when the rocket
+// passes every distance, and the inverse table keeps the launch angle for the distance
+// and elevation. The target is solved by the inverse table and refined by Newton
+// iterations on the forward table, so the shot does not integrate any trajectory.
+class AimSolver
+{
+public:
+    // Solver of the kind. Tables are built on the first call, which must be made before
+    // the simulation thread is started (see SaluteBattery::Init).
+    static const AimSolver& Instance(RocketKindId kind);
+
+    // Launch angle in degrees and burst distance for the target relative to the muzzle (y is up).
+    // Returns false if the rocket can not reach the target.
+    bool Solve(float dx, float dy, float& angle, float& distance) const;
+
+private:
+    explicit AimSolver(RocketKindId kind);
+    AimSolver(const AimSolver&) = delete;
+    AimSolver& operator=(const AimSolver&) = delete;
+
+    // Integrate the trajectory of the angle row into the forward table
+    void BuildRow(RocketKindId kind, int row);
+
+    // Invert the distance column into the inverse table
+    void BuildColumn(int column);
+
+    // Elevation of the forward table for the angle row and the distance, NaN if it is not reached
+    float Elevation(int row, float distance) const;
+
+    // Number of the angles, distances and elevations in the tables
+    int mAngles;
+    int mDistances;
+    int mElevations;
+
+    // Forward table: elevation in degrees by angle rows and distance columns
+    std::vector<float> mForward;
+    // Inverse table: launch angle in degrees by distance rows and elevation columns
+    std::vector<float> mInverse;
+};
+
+}
@@ -0,0 +1,104 @@
+/**
+ * \file
+ * \brief Global allocation hook, which counts heap allocations per thread
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "AllocTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+
+namespace memory
+{
+
+namespace
+{
+
+thread_local AllocStats THREAD_STATS;
+
+}
+
+AllocStats ThreadStats()
+{
+    return THREAD_STATS;
+}
+
+#if defined(SALUTE_TRACK_ALLOCS)
+
+namespace
+{
+
+void* TrackedAlloc(size_t size)
+{
+    ++THREAD_STATS.mCount;
+    THREAD_STATS.mBytes += size;
+    return malloc(size ? size : 1);
+}
+
+}
+
+#endif
+
+}
+
+#if defined(SALUTE_TRACK_ALLOCS)
+
+void* operator new(size_t size)
+{
+    if (void* ptr = memory::TrackedAlloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (void* ptr = memory::TrackedAlloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return memory::TrackedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return memory::TrackedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    free(ptr);
+}
+
+#endif
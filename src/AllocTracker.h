@@ -0,0 +1,38 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Opt-in counting of heap allocations per thread
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+
+
+namespace memory
+{
+
+// Heap allocations of the thread since its start
+struct AllocStats
+{
+    uint64_t mCount = 0;
+    uint64_t mBytes = 0;
+
+    AllocStats operator-(const AllocStats& other) const
+    {
+        return { mCount - other.mCount, mBytes - other.mBytes };
+    }
+};
+
+// Allocations are counted in this build (Debug and Profile configurations)
+#if defined(SALUTE_TRACK_ALLOCS)
+constexpr bool TRACK_ALLOCS = true;
+#else
+constexpr bool TRACK_ALLOCS = false;
+#endif
+
+// Allocations of the current thread. They are counted only with SALUTE_TRACK_ALLOCS,
+// otherwise the stats are always zero.
+AllocStats ThreadStats();
+
+}
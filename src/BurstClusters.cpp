@@ -0,0 +1,124 @@
+/**
+ * \file
+ * \brief Implementation of the clusters of the bursts
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "BurstClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace weapons
+{
+
+namespace
+{
+
+// Number of the emitters of the cluster: one more for every doubling of the bursts
+int EmitterBudget(int bursts)
+{
+    int emitters = 1;
+    while (bursts >>= 1)
+        ++emitters;
+    return std::min(emitters, BURST_MAX_EMITTERS);
+}
+
+// Number of the ticks, while the cluster takes the bursts
+uint64_t MergeTicks()
+{
+    return static_cast<uint64_t>(BURST_MERGE_TIME * SIMULATION_RATE);
+}
+
+}
+
+BurstClusters::BurstClusters()
+    : mMerged(0)
+{
+}
+
+bool BurstClusters::Add(float x, float y, res::Handle effect, uint64_t tick)
+{
+    // The first burst of any suitable cluster is in one of the nine cells around the burst
+    int cell_x = CellIndex(x);
+    int cell_y = CellIndex(y);
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            auto cell = mCells.find(CellKey(cell_x + dx, cell_y + dy));
+            if (cell == mCells.end())
+                continue;
+
+            for (int index = cell->second; index >= 0; index = mClusters[index].mNext)
+            {
+                auto& cluster = mClusters[index];
+                if (cluster.mEffect != effect || tick - cluster.mTick > MergeTicks() ||
+                    std::hypot(x - cluster.mX, y - cluster.mY) > BURST_MERGE_RADIUS)
+                    continue;
+
+                ++cluster.mBursts;
+                if (EmitterBudget(cluster.mBursts) > cluster.mEmitters)
+                {
+                    ++cluster.mEmitters;
+                    return true;
+                }
+                ++mMerged;
+                return false;
+            }
+        }
+    }
+
+    mClusters.push_back({ x, y, tick, effect, 1, 1, -1 });
+    Link(static_cast<int>(mClusters.size()) - 1);
+    return true;
+}
+
+uint64_t BurstClusters::CellKey(int cell_x, int cell_y)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cell_x)) << 32) | static_cast<uint32_t>(cell_y);
+}
+
+int BurstClusters::CellIndex(float value)
+{
+    return static_cast<int>(std::floor(value / BURST_MERGE_RADIUS));
+}
+
+void BurstClusters::Clear()
+{
+    mClusters.clear();
+    mCells.clear();
+}
+
+void BurstClusters::Expire(uint64_t tick)
+{
+    auto end = std::remove_if(mClusters.begin(), mClusters.end(), [tick](const Cluster& cluster)
+    {
+        return tick - cluster.mTick > MergeTicks();
+    });
+    if (end == mClusters.end())
+        return;
+
+    // Indices of the clusters are changed, so the hash is built again
+    mClusters.erase(end, mClusters.end());
+    mCells.clear();
+    for (size_t index = 0; index < mClusters.size(); index++)
+        Link(static_cast<int>(index));
+}
+
+void BurstClusters::Link(int index)
+{
+    auto& cluster = mClusters[index];
+    auto cell = mCells.emplace(CellKey(CellIndex(cluster.mX), CellIndex(cluster.mY)), index);
+    cluster.mNext = -1;
+    if (!cell.second)
+    {
+        cluster.mNext = cell.first->second;
+        cell.first->second = index;
+    }
+}
+
+}
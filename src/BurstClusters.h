@@ -0,0 +1,77 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Clusters of the bursts, which are close in space and time
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Params.h"
+#include "ResourceIds.h"
+
+
+namespace weapons
+{
+
+// Sub-rockets of one level often burst in the same frame and a few pixels apart,
+// so their full effects overlap. Bursts of one effect, which are closer than
+// BURST_MERGE_RADIUS to the first burst of the cluster and not later than BURST_MERGE_TIME,
+// join the cluster. The cluster grows by a new emitter only when its number of bursts
+// doubles, so the emitters cover the cluster, but their number grows as the logarithm.
+// Clusters are found by the spatial hash with the cell of the merge radius.
+class BurstClusters
+{
+public:
+    BurstClusters();
+
+    // Add the burst on the simulation tick. Returns true if the burst must be shown
+    // by the new emitter, otherwise it was merged into the emitters of the cluster.
+    bool Add(float x, float y, res::Handle effect, uint64_t tick);
+
+    // Drop the clusters, which can not take the bursts of the tick
+    void Expire(uint64_t tick);
+
+    // Drop all clusters
+    void Clear();
+
+    // Number of the bursts, which were merged without their own emitter
+    uint64_t Merged() const { return mMerged; }
+
+    // Number of the live clusters
+    size_t Count() const { return mClusters.size(); }
+
+private:
+    struct Cluster
+    {
+        // First burst of the cluster
+        float mX;
+        float mY;
+        uint64_t mTick;
+        res::Handle mEffect;
+        // Number of the bursts and the emitters
+        int mBursts;
+        int mEmitters;
+        // Next cluster of the hash cell or -1
+        int mNext;
+    };
+
+    // Key of the hash cell
+    static uint64_t CellKey(int cell_x, int cell_y);
+
+    // Index of the hash cell by the coordinate
+    static int CellIndex(float value);
+
+    // Add the cluster into its hash cell
+    void Link(int index);
+
+    std::vector<Cluster> mClusters;
+    // First cluster of every hash cell
+    std::unordered_map<uint64_t, int> mCells;
+    uint64_t mMerged;
+};
+
+}
@@ -7,6 +7,11 @@
 #include "stdafx.h"
 
 #include "Components.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Profiler.h"
 #include "Utils.h"
 #include "Params.h"
 
@@ -14,11 +19,64 @@
 namespace components
 {
 
+namespace
+{
+
+// Font and margin around the text of the text runs
+const std::string TEXT_RUN_FONT = "arial";
+constexpr int TEXT_RUN_MARGIN = 2;
+
+}
+
+//------------------------------------------------------------------------------------
+// TextRun
+
+TextRun::~TextRun()
+{
+    if (mTarget)
+        Render::device.DeleteRenderTarget(mTarget);
+}
+
+void TextRun::Bake(const std::string& text, float scale)
+{
+    if (mTarget && text == mText && scale == mScale)
+        return;
+
+    mText = text;
+    mScale = scale;
+    mWidth = static_cast<int>(std::ceil(Render::getStringWidth(mText, TEXT_RUN_FONT) * mScale)) + 2 * TEXT_RUN_MARGIN;
+    mHeight = static_cast<int>(std::ceil(Render::getFontHeight(TEXT_RUN_FONT) * mScale)) + 2 * TEXT_RUN_MARGIN;
+
+    // The old target is freed, when the text does not fit it
+    if (!mTarget || mWidth > mTargetWidth || mHeight > mTargetHeight)
+    {
+        if (mTarget)
+            Render::device.DeleteRenderTarget(mTarget);
+        mTargetWidth = std::max(mWidth, mTargetWidth);
+        mTargetHeight = std::max(mHeight, mTargetHeight);
+        mTarget = Render::device.CreateRenderTarget(mTargetWidth, mTargetHeight);
+    }
+
+    Render::device.BeginRenderTo(mTarget);
+    Render::device.Clear(Color(0, 0, 0, 0));
+    Render::BindFont(TEXT_RUN_FONT);
+    Render::PrintString(mTargetWidth / 2, mTargetHeight / 2, mText, mScale, CenterAlign, CenterAlign);
+    Render::device.EndRenderTo();
+}
+
+void TextRun::Draw(int x, int y) const
+{
+    if (!mTarget || mText.empty())
+        return;
+
+    mTarget->Draw(FPoint(x - mTargetWidth * 0.5f, y - mTargetHeight * 0.5f));
+}
+
 //------------------------------------------------------------------------------------
 // Object
 
 Object::Object(const std::string& tex_enable, const std::string& tex_disable)
-   : mEnable(false), mShow(true)
+   : mEnable(false), mHover(false), mPool(nullptr), mShow(true)
 {
     mEnableTexture = utils::GetTexture(tex_enable);
     mDisableTexture = utils::GetTexture(tex_disable);
@@ -35,14 +93,39 @@ void Object::Action()
     mAction();
 }
 
+void Object::AttachTo(ObjectPool* pool)
+{
+    mPool = pool;
+    MarkDirty();
+}
+
 void Object::ChangeEnable(bool activate)
 {
+    if (mEnable == activate)
+        return;
+
     mEnable = activate;
+    MarkDirty();
+}
+
+void Object::ChangeHover(bool hover)
+{
+    if (mHover == hover)
+        return;
+
+    mHover = hover;
+    MarkDirty();
 }
 
 void Object::ChangeShow(bool show)
 {
+    if (mShow == show)
+        return;
+
     mShow = show;
+    // The hidden object does not get the mouse moves, so the hover is set again by the next move
+    mHover = false;
+    MarkDirty();
 }
 
 bool Object::CheckHitOnObject(int x, int y)
@@ -56,6 +139,12 @@ void Object::InitAction(std::function<void()> action)
     mAction = action; 
 }
 
+void Object::MarkDirty()
+{
+    if (mPool)
+        mPool->Invalidate();
+}
+
 //------------------------------------------------------------------------------------
 // Button
 
@@ -163,6 +252,15 @@ Switcher::Switcher(const std::string& name,
     mShow = false;
 }
 
+void Switcher::AttachTo(ObjectPool* pool)
+{
+    Object::AttachTo(pool);
+    if (mLeftButton)
+        mLeftButton->AttachTo(pool);
+    if (mRightButton)
+        mRightButton->AttachTo(pool);
+}
+
 void Switcher::Draw()
 {
     if (!mShow)
@@ -170,14 +268,12 @@ void Switcher::Draw()
     
     Render::device.PushMatrix();
     Render::device.MatrixTranslate(mRect.mX, mRect.mY, 0.0f);
-    auto mouse = Core::mainInput.GetMousePos();
-    bool is_mouse_hit = CheckHitOnObject(mouse.x, mouse.y);
-    auto pic_tex = is_mouse_hit ? mEnableTexture : mDisableTexture;
+    auto pic_tex = mHover ? mEnableTexture : mDisableTexture;
     pic_tex->Draw();
     Render::device.PopMatrix();
 
-    auto& print_name = is_mouse_hit && !mSettingName.empty() ? mSettingName : mName;
-    Render::PrintString(mNameRect.mX, mNameRect.mY, print_name, 2.0f, CenterAlign, CenterAlign);
+    auto& print_run = mHover && !mSettingName.empty() ? mSettingRun : mNameRun;
+    print_run.Draw(mNameRect.mX, mNameRect.mY);
 
     if (mLeftButton)
         mLeftButton->Draw();
@@ -207,6 +303,21 @@ bool Switcher::OnMouseUp(int x, int y)
     return is_hit;
 }
 
+void Switcher::Prepare()
+{
+    mNameRun.Bake(mName, 2.0f);
+    mSettingRun.Bake(mSettingName, 2.0f);
+}
+
+void Switcher::SetSettingName(const std::string& set_name)
+{
+    if (mSettingName == set_name)
+        return;
+
+    mSettingName = set_name;
+    MarkDirty();
+}
+
 SwitcherPtr NewSwitcher(const std::string& name,
                         const std::shared_ptr<Object>& left,
                         const std::shared_ptr<Object>& right)
@@ -216,28 +327,78 @@ SwitcherPtr NewSwitcher(const std::string& name,
 
 //-------------------------------------------------------------------------------------
 // ObjectPool
+
+void ObjectPool::Attach(const ObjectPtr& object)
+{
+    mObjectList.push_back(object);
+    object->AttachTo(this);
+}
+
 bool ObjectPool::CheckMouseDown(int x, int y)
 {
-    for (auto& object : mObjectList)
+    for (auto object : mVisible)
         if (object->OnMouseDown(x, y))
             return true;
 
     return false;
 }
 
+void ObjectPool::CheckMouseMove(int x, int y)
+{
+    // The objects, which were hidden after the last composition, are skipped,
+    // so the pool is marked as changed only by the hover of the visible objects
+    for (auto object : mVisible)
+        if (object->mShow)
+            object->ChangeHover(object->CheckHitOnObject(x, y));
+}
+
 bool ObjectPool::CheckMouseUp(int x, int y)
 {
-    for (auto& object : mObjectList)
+    for (auto object : mVisible)
         if (object->OnMouseUp(x, y))
             return true;
 
     return false;
 }
 
-void ObjectPool::DrawAll()
+void ObjectPool::Compose()
 {
+    PROFILE_ZONE("ObjectPool::Compose");
+    mVisible.clear();
     for (auto& object : mObjectList)
+        if (object->mShow)
+            mVisible.push_back(object.get());
+
+    if (mVisible.empty())
+        return;
+
+    // Text is baked before the layer starts rendering
+    for (auto object : mVisible)
+        object->Prepare();
+
+    // The layer is owned by the render device and lives until the application exits
+    if (!mLayer)
+        mLayer = Render::device.CreateRenderTarget(Config::WinWidth(), Config::WinHeight());
+
+    // The layer is cleared, so the hidden objects do not stay on it
+    Render::device.BeginRenderTo(mLayer);
+    Render::device.Clear(Color(0, 0, 0, 0));
+    for (auto object : mVisible)
         object->Draw();
+    Render::device.EndRenderTo();
+}
+
+void ObjectPool::DrawAll()
+{
+    PROFILE_ZONE("ObjectPool::DrawAll");
+    if (mDirty)
+    {
+        Compose();
+        mDirty = false;
+    }
+
+    if (!mVisible.empty())
+        mLayer->Draw(FPoint(0.0f, 0.0f));
 }
 
 //-------------------------------------------------------------------------------------
@@ -255,7 +416,7 @@ Menu::Menu(int x, int y)
 
 void Menu::AddSwitcher(const SwitcherPtr& switch_obj)
 {
-    mObjectList.push_back(switch_obj);
+    Attach(switch_obj);
     auto width = switch_obj->mRect.mWidth;
     if (width > mRect.mWidth)
         mRect.mWidth = width + 2 * mDeltaX;
@@ -310,7 +471,7 @@ void Menu::Show(bool activate)
 
 void ButtonPool::AddObject(const ObjectPtr& object)
 {
-    mObjectList.push_back(object);
+    Attach(object);
 }
 
 void ButtonPool::AddObjects(std::initializer_list<ObjectPtr> objects)
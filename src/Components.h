@@ -10,6 +10,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Utils.h"
 
@@ -17,6 +18,42 @@
 namespace components
 {
 
+class ObjectPool;
+
+// Text, which is rendered once into its own target and drawn by one quad
+// until the text is changed.
+class TextRun
+{
+public:
+    TextRun() = default;
+    ~TextRun();
+
+    // Render the text into the target if the text or the scale was changed.
+    // The target is sized by the measured text and is created again only if the text does not fit it.
+    void Bake(const std::string& text, float scale);
+    // Draw the baked text centered in (x, y) position
+    void Draw(int x, int y) const;
+
+    // Size of the baked text with the margins
+    int Width() const { return mWidth; }
+    int Height() const { return mHeight; }
+
+private:
+    TextRun(const TextRun&) = delete;
+    TextRun& operator=(const TextRun&) = delete;
+
+    // Target with rendered text and its size, it only grows
+    Render::Target* mTarget = nullptr;
+    int mTargetWidth = 0;
+    int mTargetHeight = 0;
+    // Baked text and its size
+    std::string mText;
+    int mWidth = 0;
+    int mHeight = 0;
+    float mScale = 0.0f;
+};
+
+//-------------------------------------------------------------------------------------
 // Class for describe all service objects in the game.
 class Object
 {
@@ -27,9 +64,13 @@ public:
     
     // Perform action
     void Action();
+    // Attach object to the pool, which draws it
+    virtual void AttachTo(ObjectPool* pool);
     // Put object into active mode
     void ChangeEnable(bool activate);
-    // Put object into show mode
+    // Put object into hover mode
+    void ChangeHover(bool hover);
+    // Put object into show mode, the hover mode is reset
     void ChangeShow(bool show);
     // Check that the mouse click was on the object
     bool CheckHitOnObject(int x, int y);
@@ -37,6 +78,10 @@ public:
     virtual void Draw() = 0;
     // Init action on this object
     void InitAction(std::function<void()> action);
+    // Mark the pool of the object as changed
+    void MarkDirty();
+    // Prepare cached data before the object is composed
+    virtual void Prepare() {}
     // Performing actions if the mouse down on an object
     virtual bool OnMouseDown(int x, int y) = 0;
     // Performing actions if the mouse up on an object
@@ -51,6 +96,10 @@ public:
     std::function<void()> mAction;
     // Active mode flag
     bool mEnable;
+    // Mouse hover flag
+    bool mHover;
+    // Pool, which draws the object
+    ObjectPool* mPool;
     // Object size
     utils::Rect mRect;
     // Show mode flag
@@ -92,11 +141,13 @@ struct Switcher : public Object
 
     virtual ~Switcher() = default;
     
+    void AttachTo(ObjectPool* pool) override;
     void Draw() override;
     bool OnMouseDown(int x, int y) override;
     bool OnMouseUp(int x, int y) override;
+    void Prepare() override;
     // Set the switcher's name in active mode
-    void SetSettingName(const std::string& set_name) { mSettingName = set_name; }
+    void SetSettingName(const std::string& set_name);
 
     // Smart pointer to the left button of switcher
     std::shared_ptr<Object> mLeftButton;
@@ -110,6 +161,9 @@ private:
     std::string mName;
     // Switcher's name in active mode
     std::string mSettingName;
+    // Baked switcher's names
+    TextRun mNameRun;
+    TextRun mSettingRun;
 };
 
 using SwitcherPtr = std::shared_ptr<Switcher>;
@@ -124,21 +178,40 @@ SwitcherPtr NewSwitcher(const std::string& name,
 using ObjectPtr = std::shared_ptr<Object>;
 
 // Class to control all objects.
+// Objects are composed into the offscreen layer, which is redrawn
+// only when one of the objects was changed.
 class ObjectPool
 {
 public:
     ObjectPool() = default;
     ~ObjectPool() = default;
 
+    // Add object to the pool
+    void Attach(const ObjectPtr& object);
     // Performing actions if the mouse down on one of the objects
     bool CheckMouseDown(int x, int y);
+    // Update hover mode of the visible objects
+    void CheckMouseMove(int x, int y);
     // Performing actions if the mouse up on one of the objects
     bool CheckMouseUp(int x, int y);
     // Drawing all objects
     void DrawAll();
+    // Mark the pool as changed
+    void Invalidate() { mDirty = true; }
 
     // List of the objects
     std::list<ObjectPtr> mObjectList;
+
+private:
+    // Rebuild the array of the visible objects and compose them into the layer
+    void Compose();
+
+    // Flag of the changes since the last composition
+    bool mDirty = true;
+    // Offscreen layer with the composed objects
+    Render::Target* mLayer = nullptr;
+    // Visible objects in the drawing order
+    std::vector<Object*> mVisible;
 };
 
 //-------------------------------------------------------------------------------------
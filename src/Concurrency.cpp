@@ -0,0 +1,99 @@
+/**
+ * \file
+ * \brief Implementation of the worker pool
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "Concurrency.h"
+
+#include "Profiler.h"
+
+
+namespace utils
+{
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    Resize(threads);
+}
+
+WorkerPool::~WorkerPool()
+{
+    Resize(0);
+}
+
+void WorkerPool::Resize(size_t threads)
+{
+    if (threads == mThreads.size())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mStartCondition.notify_all();
+    for (auto& thread : mThreads)
+        thread.join();
+    mThreads.clear();
+
+    mStopping = false;
+    mThreads.reserve(threads);
+    for (size_t i = 0; i < threads; i++)
+        mThreads.emplace_back(&WorkerPool::ThreadLoop, this, mGeneration);
+}
+
+void WorkerPool::RunTasks(size_t count, Task task, void* context)
+{
+    if (mThreads.empty() || count < 2)
+    {
+        for (size_t i = 0; i < count; i++)
+            task(context, i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = task;
+        mContext = context;
+        mCount = count;
+        mNext.store(0, std::memory_order_relaxed);
+        mBusy = mThreads.size();
+        ++mGeneration;
+    }
+    mStartCondition.notify_all();
+
+    Work();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this] { return mBusy == 0; });
+}
+
+void WorkerPool::ThreadLoop(uint64_t generation)
+{
+    PROFILE_THREAD("Worker");
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mStartCondition.wait(lock, [this, generation] { return mStopping || mGeneration != generation; });
+        if (mStopping)
+            return;
+
+        generation = mGeneration;
+        lock.unlock();
+        Work();
+        lock.lock();
+        if (--mBusy == 0)
+            mDoneCondition.notify_one();
+    }
+}
+
+void WorkerPool::Work()
+{
+    for (size_t index = mNext.fetch_add(1, std::memory_order_relaxed); index < mCount;
+         index = mNext.fetch_add(1, std::memory_order_relaxed))
+        mTask(mContext, index);
+}
+
+}
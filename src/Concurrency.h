@@ -0,0 +1,179 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Lock-free containers for passing data between the simulation and render threads
+ * \author Maksimovskiy A.S.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace utils
+{
+
+// Bounded queue for one producer thread and one consumer thread.
+// Capacity must be a power of two.
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() = default;
+
+    // Producer: add the element. Returns false if the queue is full.
+    bool Push(const T& value)
+    {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        mItems[tail & (Capacity - 1)] = value;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: take the element. Returns false if the queue is empty.
+    bool Pop(T& value)
+    {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire))
+            return false;
+
+        value = mItems[head & (Capacity - 1)];
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    T mItems[Capacity];
+    // Indexes are kept on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> mHead{ 0 };
+    alignas(64) std::atomic<size_t> mTail{ 0 };
+};
+
+//------------------------------------------------------------------------------------
+// Triple buffer: the producer always has a buffer to write,
+// the consumer always reads the latest completely written buffer.
+template<typename T>
+class TripleBuffer
+{
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH_FLAG = 0x4;
+
+public:
+    TripleBuffer() = default;
+
+    // Producer: buffer for writing
+    T& Back() { return mBuffers[mBack]; }
+
+    // Producer: publish the written buffer
+    void Publish()
+    {
+        mBack = mMiddle.exchange(mBack | FRESH_FLAG, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Consumer: take the latest published buffer. Returns false if nothing new was published.
+    bool Update()
+    {
+        if (!(mMiddle.load(std::memory_order_relaxed) & FRESH_FLAG))
+            return false;
+
+        mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    // Consumer: buffer for reading
+    const T& Front() const { return mBuffers[mFront]; }
+
+    // Set up all buffers before the producer and the consumer start
+    template<typename Function>
+    void InitAll(Function init)
+    {
+        for (auto& buffer : mBuffers)
+            init(buffer);
+    }
+
+private:
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    T mBuffers[3];
+    uint8_t mBack = 0;
+    std::atomic<uint8_t> mMiddle{ 1 };
+    uint8_t mFront = 2;
+};
+
+//------------------------------------------------------------------------------------
+// Pool of threads for parallel loops. The calling thread works too,
+// so the pool with N threads runs the loop on N + 1 cores.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t threads = 0);
+    ~WorkerPool();
+
+    // Start or stop threads to get the given number of them
+    void Resize(size_t threads);
+
+    // Number of threads without the calling one
+    size_t Threads() const { return mThreads.size(); }
+
+    // Call func(index) for every index in [0, count) and wait for all of them.
+    // The functor is not copied, so the call does not allocate memory.
+    template<typename Func>
+    void Run(size_t count, Func& func)
+    {
+        RunTasks(count, [](void* context, size_t index)
+        {
+            (*static_cast<Func*>(context))(index);
+        }, &func);
+    }
+
+private:
+    using Task = void (*)(void* context, size_t index);
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Take indexes of the current loop until they are over
+    void Work();
+
+    // Start the loop on all threads
+    void RunTasks(size_t count, Task task, void* context);
+
+    // Loop of the worker thread. Generation is the last loop before the start of the thread.
+    void ThreadLoop(uint64_t generation);
+
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    // Workers wait for a new loop, the caller waits for the end of the loop
+    std::condition_variable mStartCondition;
+    std::condition_variable mDoneCondition;
+
+    // Current loop
+    Task mTask = nullptr;
+    void* mContext = nullptr;
+    size_t mCount = 0;
+    // Number of the loop, workers compare it to find a new one
+    uint64_t mGeneration = 0;
+    // Workers, which have not finished the current loop
+    size_t mBusy = 0;
+    bool mStopping = false;
+
+    // Next index of the loop
+    std::atomic<size_t> mNext{ 0 };
+};
+
+}
@@ -0,0 +1,149 @@
+/**
+ * \file
+ * \brief Implementation of the frame pacing
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "Metrics.h"
+
+#if defined(ENGINE_TARGET_WIN32)
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+
+namespace pacing
+{
+
+// Weight of the new oversleep in the smoothed one
+static const float OVERSLEEP_WEIGHT = 0.1f;
+
+FramePacer::FramePacer()
+    : mRate(FRAME_RATES[0]),
+    mPeriod(0),
+    mSpinMargin(std::chrono::microseconds(PACER_MAX_SPIN_US)),
+    mOversleep(static_cast<float>(PACER_MAX_SPIN_US)),
+    mFrames(0),
+    mLateFrames(0)
+{
+#if defined(ENGINE_TARGET_WIN32)
+    // Default timer resolution is 15.6 ms, the sleep would always miss the deadline
+    timeBeginPeriod(1);
+#endif
+    mJitters.fill(0.0f);
+    SetTargetRate(mRate);
+}
+
+FramePacer::~FramePacer()
+{
+#if defined(ENGINE_TARGET_WIN32)
+    timeEndPeriod(1);
+#endif
+}
+
+FramePacer& FramePacer::Instance()
+{
+    static FramePacer pacer_instance;
+    return pacer_instance;
+}
+
+void FramePacer::SetTargetRate(int rate)
+{
+    mRate = std::max(rate, 0);
+    mPeriod = mRate ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / mRate))
+                    : Clock::duration::zero();
+    // The schedule starts again from the next frame
+    mDeadline = Clock::time_point();
+}
+
+void FramePacer::NextRate()
+{
+    auto rate = std::find(std::begin(FRAME_RATES), std::end(FRAME_RATES), mRate);
+    if (rate == std::end(FRAME_RATES) || ++rate == std::end(FRAME_RATES))
+        rate = std::begin(FRAME_RATES);
+    SetTargetRate(*rate);
+}
+
+void FramePacer::SleepUntil(Clock::time_point deadline)
+{
+    auto wake_time = deadline - mSpinMargin;
+    if (Clock::now() >= wake_time)
+        return;
+
+    std::this_thread::sleep_until(wake_time);
+    float oversleep = std::chrono::duration<float, std::micro>(Clock::now() - wake_time).count();
+    mOversleep += (oversleep - mOversleep) * OVERSLEEP_WEIGHT;
+    // The margin covers the usual oversleep twice, so only rare wakeups are late
+    float margin = std::min(std::max(2.0f * mOversleep, static_cast<float>(PACER_MIN_SPIN_US)),
+                            static_cast<float>(PACER_MAX_SPIN_US));
+    mSpinMargin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::micro>(margin));
+}
+
+void FramePacer::EndFrame()
+{
+    static auto& jitter_histogram = metrics::Registry::Instance().GetHistogram("frame.jitter_us");
+    static auto& late_counter = metrics::Registry::Instance().GetCounter("frame.late");
+    if (mPeriod == Clock::duration::zero())
+        return;
+
+    auto now = Clock::now();
+    if (mDeadline == Clock::time_point())
+    {
+        mDeadline = now + mPeriod;
+        return;
+    }
+
+    bool late = now > mDeadline;
+    if (!late)
+    {
+        SleepUntil(mDeadline);
+        while (Clock::now() < mDeadline)
+            std::this_thread::yield();
+    }
+
+    auto present_time = Clock::now();
+    auto jitter = present_time - mDeadline;
+    float jitter_us = std::chrono::duration<float, std::micro>(jitter).count();
+    jitter_histogram.Record(static_cast<uint64_t>(jitter_us));
+    mJitters[mFrames % PACER_HISTORY] = jitter_us / 1000.0f;
+    ++mFrames;
+    if (late)
+    {
+        ++mLateFrames;
+        late_counter.Add(1);
+    }
+
+    // The short lateness is compensated by the shorter next frame, so the average rate is kept.
+    // After the long stall the schedule is moved, otherwise the frames would go without waiting.
+    if (jitter > PACER_MAX_LATE_PERIODS * mPeriod)
+        mDeadline = present_time + mPeriod;
+    else
+        mDeadline += mPeriod;
+}
+
+float FramePacer::JitterPercentile(float part) const
+{
+    int count = static_cast<int>(std::min<uint64_t>(mFrames, PACER_HISTORY));
+    if (!count)
+        return 0.0f;
+
+    auto sorted = mJitters;
+    int idx = std::min(count - 1, static_cast<int>(part * count));
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.begin() + count);
+    return sorted[idx];
+}
+
+float FramePacer::SpinMargin() const
+{
+    return std::chrono::duration<float, std::milli>(mSpinMargin).count();
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Frame pacing of the render thread with the jitter statistics
+ * \author Maksimovskiy A.S.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "Params.h"
+
+
+namespace pacing
+{
+
+//------------------------------------------------------------------------------------
+// Singleton controller of the frame cadence. The end of every frame waits for its deadline:
+// the thread sleeps until the spin margin before it, then spins. The margin follows
+// the measured oversleep of the system timer. A late frame is compensated by the shorter
+// next frame, the schedule is moved only when the frame is late by several periods.
+class FramePacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Instance
+    static FramePacer& Instance();
+
+    // Set the target frame rate, zero means the unlocked rate
+    void SetTargetRate(int rate);
+
+    // Switch to the next rate of FRAME_RATES
+    void NextRate();
+
+    // Target frame rate, zero means the unlocked rate
+    int TargetRate() const { return mRate; }
+
+    // End of the frame: wait for its deadline
+    void EndFrame();
+
+    // Percentile of the last jitters (present time after the deadline) in ms
+    float JitterPercentile(float part) const;
+
+    // Frames, which were finished after their deadlines
+    uint64_t LateFrames() const { return mLateFrames; }
+
+    // Current spin margin in ms
+    float SpinMargin() const;
+
+private:
+    FramePacer();
+    ~FramePacer();
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(FramePacer&) = delete;
+
+    // Sleep until the margin before the deadline and adapt the margin by the oversleep
+    void SleepUntil(Clock::time_point deadline);
+
+    int mRate;
+    Clock::duration mPeriod;
+    // Deadline of the current frame, zero before the first frame
+    Clock::time_point mDeadline;
+    // Time before the deadline, which is spun instead of sleeping
+    Clock::duration mSpinMargin;
+    // Smoothed oversleep of the system timer in microseconds
+    float mOversleep;
+    // Last jitters in ms
+    std::array<float, PACER_HISTORY> mJitters;
+    uint64_t mFrames;
+    uint64_t mLateFrames;
+};
+
+}
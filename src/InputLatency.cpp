@@ -0,0 +1,80 @@
+/**
+ * \file
+ * \brief Implementation of the input latency tracker
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "InputLatency.h"
+
+#include <algorithm>
+
+#include "Metrics.h"
+#include "Utils.h"
+
+
+namespace input
+{
+
+LatencyTracker::LatencyTracker()
+    : mNextId(1),
+    mReflected(0),
+    mPresented(0),
+    mCount(0)
+{
+    mCaptureTimes.fill(0.0);
+    mLatencies.fill(0.0f);
+}
+
+LatencyTracker& LatencyTracker::Instance()
+{
+    static LatencyTracker tracker_instance;
+    return tracker_instance;
+}
+
+uint32_t LatencyTracker::Capture(double& time)
+{
+    time = utils::WallClock::Instance().Now();
+    uint32_t id = mNextId++;
+    mCaptureTimes[id % INPUT_IN_FLIGHT] = time;
+    return id;
+}
+
+void LatencyTracker::Reflect(uint32_t last_input)
+{
+    mReflected = std::max(mReflected, last_input);
+}
+
+void LatencyTracker::Present()
+{
+    static auto& latency_histogram = metrics::Registry::Instance().GetHistogram("input.latency_us");
+    if (mReflected == mPresented)
+        return;
+
+    // Events, which were overwritten by the newer ones, are skipped
+    double now = utils::WallClock::Instance().Now();
+    uint32_t first = std::max(mPresented + 1, mReflected >= INPUT_IN_FLIGHT ? mReflected - INPUT_IN_FLIGHT + 1 : 1);
+    for (uint32_t id = first; id <= mReflected; id++)
+    {
+        double latency = now - mCaptureTimes[id % INPUT_IN_FLIGHT];
+        latency_histogram.Record(static_cast<uint64_t>(latency * 1000000.0));
+        mLatencies[mCount % INPUT_HISTORY] = static_cast<float>(latency * 1000.0);
+        ++mCount;
+    }
+    mPresented = mReflected;
+}
+
+float LatencyTracker::Percentile(float part) const
+{
+    int count = static_cast<int>(std::min<uint64_t>(mCount, INPUT_HISTORY));
+    if (!count)
+        return 0.0f;
+
+    auto sorted = mLatencies;
+    int idx = std::min(count - 1, static_cast<int>(part * count));
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.begin() + count);
+    return sorted[idx];
+}
+
+}
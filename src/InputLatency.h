@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Input-to-present latency of the timestamped input events
+ * \author Maksimovskiy A.S.
+ */
+
+#include <array>
+#include <cstdint>
+
+#include "Params.h"
+
+
+namespace input
+{
+
+//------------------------------------------------------------------------------------
+// Singleton tracker of the input events. Every event gets the id and the capture time,
+// the simulation returns the id of the last applied event with the snapshot,
+// and the latency is measured when the frame with the snapshot is presented.
+// It is used only by the render thread.
+class LatencyTracker
+{
+public:
+    // Instance
+    static LatencyTracker& Instance();
+
+    // Stamp the new input event. Returns its id and the capture time on the wall clock.
+    uint32_t Capture(double& time);
+
+    // The drawn snapshot reflects the events up to the id
+    void Reflect(uint32_t last_input);
+
+    // The frame is presented: the latencies of the reflected events are recorded
+    void Present();
+
+    // Percentile of the last latencies in ms
+    float Percentile(float part) const;
+
+    // Number of the measured events
+    uint64_t Count() const { return mCount; }
+
+private:
+    LatencyTracker();
+    LatencyTracker(const LatencyTracker&) = delete;
+    LatencyTracker& operator=(LatencyTracker&) = delete;
+
+    // Capture times of the events in flight by id
+    std::array<double, INPUT_IN_FLIGHT> mCaptureTimes;
+    // Id of the next event, the last reflected and the last presented events
+    uint32_t mNextId;
+    uint32_t mReflected;
+    uint32_t mPresented;
+    // Last latencies in ms
+    std::array<float, INPUT_HISTORY> mLatencies;
+    uint64_t mCount;
+};
+
+}
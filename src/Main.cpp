@@ -1,5 +1,10 @@
 #include "stdafx.h"
+#include "Params.h"
 #include "SaluteDelegate.h"
+#include "FramePacer.h"
+#include "Metrics.h"
+#include "ShowTimeline.h"
+#include "StressRunner.h"
 
 #define MYAPPLICATION_NAME L"SaluteGame"
 
@@ -9,13 +14,24 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 int main(int argc, const char* argv[])
 #endif
 {
+#if defined(ENGINE_TARGET_WIN32)
+    int argc = __argc;
+    char** argv = __argv;
+#endif
+
+    // Show compiler mode: SaluteGame -show <text show> <compiled show>
+    if (argc == 4 && std::string(argv[1]) == "-show")
+        return show::CompileShow(argv[2], argv[3]) < 0 ? 1 : 0;
+
     ParticleSystem::SetTexturesPath("textures/Particles");
 
 #if defined(ENGINE_TARGET_WIN32)
-    Core::fileSystem.SetWriteDirectory("./write_directory");
+    std::string write_dir = "./write_directory";
 #else
-    Core::fileSystem.SetWriteDirectory(IO::Path::GetSpecialFolderPath(SpecialFolder::LocalDocuments));
+    std::string write_dir = IO::Path::GetSpecialFolderPath(SpecialFolder::LocalDocuments);
 #endif
+    Core::fileSystem.SetWriteDirectory(write_dir);
+    Config::SetWriteDirectory(write_dir);
     
 #if defined(ENGINE_TARGET_WIN32)
     std::string base_path = "base_p";
@@ -26,16 +42,57 @@ int main(int argc, const char* argv[])
 #endif
     
     Core::fileSystem.MountDirectory(base_path);
+    Config::SetBaseDirectory(base_path);
 
     Log::log.AddSink(new Log::DebugOutputLogSink());
     Log::log.AddSink(new Log::HtmlFileLogSink("log.htm", true));
 
+    // Headless stress mode: SaluteGame -stress <seconds> [<volley period> <volley size>] [-guns <count>]
+    // [-fanout <count>] [-state <saved state>] [-baseline <file>]
+    if (argc >= 2 && std::string(argv[1]) == "-stress")
+        return stress::RunFromArgs(argc, argv);
+
+    // Headless simulation trace mode: SaluteGame -trace <frames> <trace file> [-update]
+    if (argc >= 4 && std::string(argv[1]) == "-trace")
+        return stress::RunTraceFromArgs(argc, argv);
+
+    // Soak mode: SaluteGame -soak <hours> [-guns <count>] [-depth <level>] in the virtual time
+    if (argc >= 3 && std::string(argv[1]) == "-soak")
+        return stress::RunSoakFromArgs(argc, argv);
+
+    // Simulation server mode: SaluteGame -server <name> [-guns <count>] [-depth <level>] [-seconds <time>] [-show]
+    if (argc >= 3 && std::string(argv[1]) == "-server")
+        return stress::RunServerFromArgs(argc, argv);
+
+    // Shared memory test mode: SaluteGame -shmtest [<consumers> [<seconds>]]
+    if (argc >= 2 && std::string(argv[1]) == "-shmtest")
+        return stress::RunSharedTestFromArgs(argc, argv);
+
+    // Client mode: SaluteGame -client <name> draws the world of the simulation server
+    if (argc >= 3 && std::string(argv[1]) == "-client")
+        Config::SetSharedWorld(argv[2]);
+
+    // Resume mode: SaluteGame -resume restores the last saved state, e.g. on the kiosk after the crash
+    if (argc >= 2 && std::string(argv[1]) == "-resume")
+        Config::SetResumeState(true);
+
+    // Frame rate: SaluteGame -fps <rate> paces the frames, zero means the unlocked rate
+    for (int i = 1; i + 1 < argc; i++)
+        if (std::string(argv[i]) == "-fps")
+            pacing::FramePacer::Instance().SetTargetRate(atoi(argv[i + 1]));
+
+    auto& metrics_registry = metrics::Registry::Instance();
+    metrics_registry.AddSink(new metrics::CsvSink(write_dir + "/metrics.csv"));
+    metrics_registry.AddSink(new metrics::StatsdSink(STATSD_HOST, STATSD_PORT));
+    metrics_registry.StartExport(METRICS_PERIOD);
+
 #if defined(ENGINE_TARGET_WIN32)
     Core::Application::APPLICATION_NAME = MYAPPLICATION_NAME;
     Core::RunApplicationWithDelegate(new SaluteDelegate());
 #else
     Core::RunApplicationWithDelegate(argc, argv, new SaluteDelegate());
 #endif
-    
+
+    metrics_registry.StopExport();
     return 0;
 }
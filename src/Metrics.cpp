@@ -0,0 +1,310 @@
+/**
+ * \file
+ * \brief Implementation of the metrics registry and sinks
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "Metrics.h"
+
+#include <cstring>
+#include <sstream>
+
+#if defined(ENGINE_TARGET_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+
+#if defined(ENGINE_TARGET_WIN32)
+using NativeSocket = SOCKET;
+#else
+using NativeSocket = int;
+#endif
+
+}
+
+
+namespace metrics
+{
+
+//------------------------------------------------------------------------------------
+// Histogram
+
+int Histogram::BucketIndex(uint64_t value)
+{
+    if (value < (1u << SUB_BITS))
+        return static_cast<int>(value);
+
+    int msb = 0;
+    for (uint64_t rest = value; rest >>= 1;)
+        ++msb;
+    int shift = msb - SUB_BITS;
+    return ((shift + 1) << SUB_BITS) | static_cast<int>((value >> shift) & ((1u << SUB_BITS) - 1));
+}
+
+uint64_t Histogram::BucketValue(int idx)
+{
+    if (idx < (1 << SUB_BITS))
+        return idx;
+
+    int shift = (idx >> SUB_BITS) - 1;
+    uint64_t mantissa = (idx & ((1 << SUB_BITS) - 1)) | (1 << SUB_BITS);
+    return mantissa << shift;
+}
+
+void Histogram::Record(uint64_t value)
+{
+    mBuckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+HistogramData Histogram::Collect()
+{
+    std::array<uint64_t, BUCKETS> counts;
+    HistogramData data;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        counts[i] = mBuckets[i].exchange(0, std::memory_order_relaxed);
+        data.mCount += counts[i];
+    }
+
+    if (!data.mCount)
+        return data;
+
+    uint64_t p50_rank = (data.mCount * 50 + 99) / 100;
+    uint64_t p99_rank = (data.mCount * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        if (!counts[i])
+            continue;
+
+        if (seen < p50_rank && seen + counts[i] >= p50_rank)
+            data.mP50 = BucketValue(i);
+        if (seen < p99_rank && seen + counts[i] >= p99_rank)
+            data.mP99 = BucketValue(i);
+        seen += counts[i];
+        data.mMax = BucketValue(i);
+    }
+    return data;
+}
+
+//------------------------------------------------------------------------------------
+// CsvSink
+
+CsvSink::CsvSink(const std::string& path)
+    : mFile(path, std::ios::app)
+{
+    if (mFile.tellp() == 0)
+        mFile << "time,name,type,value,p50,p99,max\n";
+}
+
+void CsvSink::Export(const Report& report)
+{
+    if (!mFile)
+        return;
+
+    for (auto& counter : report.mCounters)
+        mFile << report.mTime << ',' << counter.first << ",counter," << counter.second << ",,,\n";
+    for (auto& gauge : report.mGauges)
+        mFile << report.mTime << ',' << gauge.first << ",gauge," << gauge.second << ",,,\n";
+    for (auto& histogram : report.mHistograms)
+    {
+        auto& data = histogram.second;
+        mFile << report.mTime << ',' << histogram.first << ",histogram," << data.mCount << ','
+              << data.mP50 << ',' << data.mP99 << ',' << data.mMax << '\n';
+    }
+    mFile.flush();
+}
+
+//------------------------------------------------------------------------------------
+// StatsdSink
+
+// Max size of the datagram, which is not fragmented on the local network
+static const size_t STATSD_PACKET_SIZE = 1400;
+
+StatsdSink::StatsdSink(const std::string& host, int port)
+{
+#if defined(ENGINE_TARGET_WIN32)
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+    mSocket = static_cast<intptr_t>(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, host.c_str(), &address.sin_addr);
+    static_assert(sizeof(address) <= sizeof(mAddress), "Address does not fit");
+    memcpy(mAddress.data(), &address, sizeof(address));
+}
+
+StatsdSink::~StatsdSink()
+{
+#if defined(ENGINE_TARGET_WIN32)
+    closesocket(static_cast<NativeSocket>(mSocket));
+    WSACleanup();
+#else
+    close(static_cast<NativeSocket>(mSocket));
+#endif
+}
+
+void StatsdSink::Send(const std::string& packet)
+{
+    if (packet.empty() || mSocket < 0)
+        return;
+
+    sendto(static_cast<NativeSocket>(mSocket), packet.data(), static_cast<int>(packet.size()), 0,
+           reinterpret_cast<const sockaddr*>(mAddress.data()), sizeof(sockaddr_in));
+}
+
+void StatsdSink::Export(const Report& report)
+{
+    std::string packet;
+    auto add_line = [this, &packet](const std::string& line)
+    {
+        if (packet.size() + line.size() + 1 > STATSD_PACKET_SIZE)
+        {
+            Send(packet);
+            packet.clear();
+        }
+        packet += line;
+        packet += '\n';
+    };
+
+    for (auto& counter : report.mCounters)
+    {
+        auto& prev = mPrevCounters[counter.first];
+        add_line(counter.first + ":" + std::to_string(counter.second - prev) + "|c");
+        prev = counter.second;
+    }
+    for (auto& gauge : report.mGauges)
+        add_line(gauge.first + ":" + std::to_string(gauge.second) + "|g");
+    for (auto& histogram : report.mHistograms)
+    {
+        auto& data = histogram.second;
+        if (!data.mCount)
+            continue;
+        add_line(histogram.first + ".p50:" + std::to_string(data.mP50) + "|g");
+        add_line(histogram.first + ".p99:" + std::to_string(data.mP99) + "|g");
+        add_line(histogram.first + ".max:" + std::to_string(data.mMax) + "|g");
+    }
+    Send(packet);
+}
+
+//------------------------------------------------------------------------------------
+// Registry
+
+Registry::Registry()
+    : mRunning(false),
+    mStartTime(std::chrono::steady_clock::now())
+{
+}
+
+Registry::~Registry()
+{
+    StopExport();
+}
+
+Registry& Registry::Instance()
+{
+    static Registry registry_instance;
+    return registry_instance;
+}
+
+Counter& Registry::GetCounter(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& counter = mCounters[name];
+    if (!counter)
+        counter = std::make_unique<Counter>();
+    return *counter;
+}
+
+Gauge& Registry::GetGauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& gauge = mGauges[name];
+    if (!gauge)
+        gauge = std::make_unique<Gauge>();
+    return *gauge;
+}
+
+Histogram& Registry::GetHistogram(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& histogram = mHistograms[name];
+    if (!histogram)
+        histogram = std::make_unique<Histogram>();
+    return *histogram;
+}
+
+void Registry::AddSink(Sink* sink)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSinks.emplace_back(sink);
+}
+
+void Registry::Flush()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Report report;
+    report.mTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
+    for (auto& counter : mCounters)
+        report.mCounters.emplace_back(counter.first, counter.second->Value());
+    for (auto& gauge : mGauges)
+        report.mGauges.emplace_back(gauge.first, gauge.second->Value());
+    for (auto& histogram : mHistograms)
+        report.mHistograms.emplace_back(histogram.first, histogram.second->Collect());
+
+    for (auto& sink : mSinks)
+        sink->Export(report);
+}
+
+void Registry::StartExport(float period)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mRunning)
+        return;
+
+    mRunning = true;
+    auto wait_time = std::chrono::duration<float>(period);
+    mThread = std::thread([this, wait_time]()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mRunning)
+        {
+            mWakeUp.wait_for(lock, wait_time);
+            if (!mRunning)
+                break;
+
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    });
+}
+
+void Registry::StopExport()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning)
+            return;
+        mRunning = false;
+    }
+    mWakeUp.notify_all();
+    mThread.join();
+    Flush();
+}
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Registry of counters, gauges and latency histograms with pluggable exporters
+ * \author Maksimovskiy A.S.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace metrics
+{
+
+// Monotonic counter
+class Counter
+{
+public:
+    void Add(uint64_t value = 1) { mValue.fetch_add(value, std::memory_order_relaxed); }
+    uint64_t Value() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> mValue{ 0 };
+};
+
+// Last set value
+class Gauge
+{
+public:
+    void Set(double value) { mValue.store(value, std::memory_order_relaxed); }
+    double Value() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> mValue{ 0.0 };
+};
+
+// Percentiles of the histogram for one export period
+struct HistogramData
+{
+    uint64_t mCount = 0;
+    uint64_t mP50 = 0;
+    uint64_t mP99 = 0;
+    uint64_t mMax = 0;
+};
+
+// Histogram with log-linear buckets: every power of two is split into 16 buckets,
+// so the value is known with the precision about 6%.
+class Histogram
+{
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int BUCKETS = 64 << SUB_BITS;
+
+    // Add the value, for example latency in microseconds
+    void Record(uint64_t value);
+
+    // Take the data of the values since the previous call
+    HistogramData Collect();
+
+private:
+    static int BucketIndex(uint64_t value);
+    static uint64_t BucketValue(int idx);
+
+    std::array<std::atomic<uint64_t>, BUCKETS> mBuckets = {};
+};
+
+//------------------------------------------------------------------------------------
+// Current values of all metrics, which are passed to the sinks
+struct Report
+{
+    // Seconds since the start of the export
+    double mTime = 0.0;
+    std::vector<std::pair<std::string, uint64_t>> mCounters;
+    std::vector<std::pair<std::string, double>> mGauges;
+    std::vector<std::pair<std::string, HistogramData>> mHistograms;
+};
+
+// Exporter of the metrics
+class Sink
+{
+public:
+    virtual ~Sink() = default;
+    virtual void Export(const Report& report) = 0;
+};
+
+// Sink appends rows "time,name,type,value,p50,p99,max" into the CSV file
+class CsvSink : public Sink
+{
+public:
+    explicit CsvSink(const std::string& path);
+    void Export(const Report& report) override;
+
+private:
+    std::ofstream mFile;
+};
+
+// Sink sends the statsd lines over UDP to the local collector
+class StatsdSink : public Sink
+{
+public:
+    StatsdSink(const std::string& host, int port);
+    ~StatsdSink();
+    void Export(const Report& report) override;
+
+private:
+    // Send the collected lines as one datagram
+    void Send(const std::string& packet);
+
+    // Counters at the previous export, statsd expects increments
+    std::map<std::string, uint64_t> mPrevCounters;
+    // Socket and address of the collector
+    intptr_t mSocket;
+    std::array<uint8_t, 16> mAddress;
+};
+
+//------------------------------------------------------------------------------------
+// Singleton registry of all metrics.
+// Metrics are never removed, so the references can be cached.
+class Registry
+{
+public:
+    // Instance
+    static Registry& Instance();
+
+    // Get or create the metric
+    Counter& GetCounter(const std::string& name);
+    Gauge& GetGauge(const std::string& name);
+    Histogram& GetHistogram(const std::string& name);
+
+    // Add the sink. Registry takes ownership.
+    void AddSink(Sink* sink);
+
+    // Export all metrics to the sinks now
+    void Flush();
+
+    // Start the thread, which exports metrics every period in seconds
+    void StartExport(float period);
+
+    // Stop the export thread
+    void StopExport();
+
+private:
+    Registry();
+    ~Registry();
+    Registry(const Registry&) = delete;
+    Registry& operator=(Registry&) = delete;
+
+    std::map<std::string, std::unique_ptr<Counter>> mCounters;
+    std::map<std::string, std::unique_ptr<Gauge>> mGauges;
+    std::map<std::string, std::unique_ptr<Histogram>> mHistograms;
+    std::vector<std::unique_ptr<Sink>> mSinks;
+    std::mutex mMutex;
+
+    // Export thread
+    std::thread mThread;
+    std::condition_variable mWakeUp;
+    bool mRunning;
+    std::chrono::steady_clock::time_point mStartTime;
+};
+
+}
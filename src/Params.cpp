@@ -22,12 +22,8 @@ const float TWO_PI_DEGREES = 360.0f;
 
 // Acceleration of gravity
 const float G = 9.81f;
-// Air resistance (kg / m ^ 3)
-const float RHO = 1.23;
 
 // Rocket params
-const std::string ROCKET_TEXTURE = "RedRocket";
-const int ROCKET_VELOCITY = 135;
 // Min and max distances for rocket's fly
 const int MIN_DISTANCE = 200;
 const int MAX_DISTANCE = 400;
@@ -37,18 +33,28 @@ const int MAIN_MAX_DISTANCE = 750;
 // Min and max delta angles for rocket's fly
 const int MIN_DELTA_ANGLE = 90;
 const int MAX_DELTA_ANGLE = 150;
-// Angular velocity
-const float ROCKET_RPM = 150.0f;
-// Cross sectional area in m ^ 2
-const float ROCKET_S = 0.0016f;
-// Rocket mass in kg
-const float ROCKET_MASS = 5.0f;
 
 // Salute gun params
-const std::string GUN_TEXTURE = "SaluteGun";
 const int GUN_VELOCITY = 30;
 const float HAND_SHOT_PERIOD = 0.5f;
 const float SHOT_PERIOD = 5.0f;
+// Number of the salute guns along the skyline
+const int BATTERY_SIZE = 1;
+// Show, which is played by the "F7" key (without extension)
+const std::string SHOW_FILE = "shows/Demo";
+
+// Duration of the dumped profiler trace in seconds
+const float TRACE_DURATION = 10.0f;
+
+// Saved state of the world and the period of the autosave in seconds
+const std::string SAVE_FILE = "salute.sav";
+const float AUTOSAVE_PERIOD = 30.0f;
+
+// Period of the metrics export in seconds
+const float METRICS_PERIOD = 10.0f;
+// Address of the local statsd collector
+const std::string STATSD_HOST = "127.0.0.1";
+const int STATSD_PORT = 8125;
 
 // Component's textures
 const std::string CURSOR_TEXTURE = "Cursor";
@@ -74,11 +80,6 @@ const std::string TYPE_SWITCHER = "Salute type";
 const std::string CONTINUE_SWITCHER = "Continue";
 const std::string EXIT_SWITCHER = "Exit";
 
-// Effects
-const std::string FLY_ROCKET_EFFECT = "FlyRocket";
-const std::string SHOT_EFFECT = "Shot";
-const std::string SALUTE_EFFECT = "Salute";
-
 // Backgrounds const
 const std::string BACKGROUND_FIRST = "Background1";
 const std::string BACKGROUND_FIRST_NAME = "Sidney";
@@ -96,15 +97,15 @@ const std::string DIFFICULTY_THIRD = "2";
 const std::string DIFFICULTY_THIRD_NAME = "Hard";
 const std::string DIFFICULTY_FORTH = "3";
 const std::string DIFFICULTY_FORTH_NAME = "Apocalypse";
+const std::string DIFFICULTY_FIFTH = "6";
+const std::string DIFFICULTY_FIFTH_NAME = "Inferno";
+const std::string DIFFICULTY_SIXTH = "9";
+const std::string DIFFICULTY_SIXTH_NAME = "Armageddon";
 
 // Salute types const
-const std::string SALUTE_TYPE_FIRST = "Salute1";
 const std::string SALUTE_TYPE_FIRST_NAME = "Stars scatter";
-const std::string SALUTE_TYPE_SECOND = "Salute2";
 const std::string SALUTE_TYPE_SECOND_NAME = "Rain fall";
-const std::string SALUTE_TYPE_THIRD = "Salute3";
 const std::string SALUTE_TYPE_THIRD_NAME = "Rainbow glow";
-const std::string SALUTE_TYPE_FORTH = "Mix";
 const std::string SALUTE_TYPE_FORTH_NAME = "Salute mixed";
 
 // Background types
@@ -133,16 +134,18 @@ Config::SettingsType Config::Difficulty()
     auto second_level = std::make_pair(DIFFICULTY_SECOND, DIFFICULTY_SECOND_NAME);
     auto third_level = std::make_pair(DIFFICULTY_THIRD, DIFFICULTY_THIRD_NAME);
     auto forth_level = std::make_pair(DIFFICULTY_FORTH, DIFFICULTY_FORTH_NAME);
-    return { first_level, second_level, third_level, forth_level };
+    auto fifth_level = std::make_pair(DIFFICULTY_FIFTH, DIFFICULTY_FIFTH_NAME);
+    auto sixth_level = std::make_pair(DIFFICULTY_SIXTH, DIFFICULTY_SIXTH_NAME);
+    return { first_level, second_level, third_level, forth_level, fifth_level, sixth_level };
 }
 
 // Salute types
 Config::SettingsType Config::SaluteTypes()
 {
-    auto first_type = std::make_pair(SALUTE_TYPE_FIRST, SALUTE_TYPE_FIRST_NAME);
-    auto second_type = std::make_pair(SALUTE_TYPE_SECOND, SALUTE_TYPE_SECOND_NAME);
-    auto third_type = std::make_pair(SALUTE_TYPE_THIRD, SALUTE_TYPE_THIRD_NAME);
-    auto forth_type = std::make_pair(SALUTE_TYPE_FORTH, SALUTE_TYPE_FORTH_NAME);
+    auto first_type = SettingType(SALUTE_TYPE_FIRST, SALUTE_TYPE_FIRST_NAME);
+    auto second_type = SettingType(SALUTE_TYPE_SECOND, SALUTE_TYPE_SECOND_NAME);
+    auto third_type = SettingType(SALUTE_TYPE_THIRD, SALUTE_TYPE_THIRD_NAME);
+    auto forth_type = SettingType(SALUTE_TYPE_FORTH, SALUTE_TYPE_FORTH_NAME);
     static auto types = { first_type, second_type, third_type, forth_type };
     return types;
 }
@@ -164,3 +167,51 @@ int Config::WinHeight()
     static auto y_screen = GetSystemMetrics(SM_CYSCREEN);
     return y_screen;
 }
+
+std::string Config::mWriteDirectory = ".";
+
+const std::string& Config::WriteDirectory()
+{
+    return mWriteDirectory;
+}
+
+void Config::SetWriteDirectory(const std::string& path)
+{
+    mWriteDirectory = path;
+}
+
+std::string Config::mBaseDirectory = "base_p";
+
+const std::string& Config::BaseDirectory()
+{
+    return mBaseDirectory;
+}
+
+void Config::SetBaseDirectory(const std::string& path)
+{
+    mBaseDirectory = path;
+}
+
+std::string Config::mSharedWorld;
+
+const std::string& Config::SharedWorld()
+{
+    return mSharedWorld;
+}
+
+void Config::SetSharedWorld(const std::string& name)
+{
+    mSharedWorld = name;
+}
+
+bool Config::mResumeState = false;
+
+bool Config::ResumeState()
+{
+    return mResumeState;
+}
+
+void Config::SetResumeState(bool resume)
+{
+    mResumeState = resume;
+}
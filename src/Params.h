@@ -6,6 +6,8 @@
  * \author Maksimovskiy A.S.
  */
 
+#include <cstdint>
+
 // Add delta x to main button's positions
 #define BUTTON_DELTA_POS 15
 // Add delta x and y to menu switcher
@@ -25,14 +27,17 @@ extern const float TWO_PI_DEGREES;
 // Acceleration of gravity
 extern const float G;
 // Air resistance (kg / m ^ 3)
-extern const float RHO;
+constexpr float RHO = 1.23f;
 // Dimension of arrays for the Runge - Kutta formula
 constexpr int N_DIM = 4;
+// Steps of the simulation thread per second
+constexpr int SIMULATION_RATE = 120;
+// Steps of the simulation before it must stop allocating memory
+constexpr int ALLOC_WARMUP_STEPS = 10 * SIMULATION_RATE;
 
 // Rocket params
-extern const std::string ROCKET_TEXTURE;
-extern const std::string ROCKET_TEXTURE_MINI;
-extern const int ROCKET_VELOCITY;
+constexpr char ROCKET_TEXTURE[] = "RedRocket";
+constexpr int ROCKET_VELOCITY = 135;
 // Min and max distances for rocket's fly
 extern const int MIN_DISTANCE;
 extern const int MAX_DISTANCE;
@@ -43,17 +48,78 @@ extern const int MAIN_MAX_DISTANCE;
 extern const int MIN_DELTA_ANGLE;
 extern const int MAX_DELTA_ANGLE;
 // Angular velocity
-extern const float ROCKET_RPM;
+constexpr float ROCKET_RPM = 150.0f;
 // Cross sectional area in m ^ 2
-extern const float ROCKET_S;
+constexpr float ROCKET_S = 0.0016f;
 // Rocket mass in kg
-extern const float ROCKET_MASS;
+constexpr float ROCKET_MASS = 5.0f;
+// Acceleration of the rocket by the wind per unit of the wind speed
+constexpr float ROCKET_WIND_DRAG = 0.2f;
+
+// Sub-rockets of one burst by default
+constexpr int FAN_OUT = 3;
+// Max number of the live rockets of the battery and of the live effects of the view.
+// Deep chain reactions are cut by them, so the memory is bounded for any difficulty.
+constexpr int ROCKET_CAPACITY = 32768;
+constexpr int EFFECT_CAPACITY = 2048;
+
+// Aim solver params: launch angles and their step in degrees, max burst distance and its step in pixels,
+// step of the elevation in degrees, Newton iterations and the tolerance of the elevation in degrees
+constexpr float AIM_MIN_ANGLE = 5.0f;
+constexpr float AIM_MAX_ANGLE = 175.0f;
+constexpr float AIM_ANGLE_STEP = 0.5f;
+constexpr float AIM_MAX_DISTANCE = 1200.0f;
+constexpr float AIM_DISTANCE_STEP = 10.0f;
+constexpr float AIM_ELEVATION_STEP = 1.0f;
+constexpr int AIM_NEWTON_STEPS = 4;
+constexpr float AIM_TOLERANCE = 0.01f;
+
+// Burst clusters: merge radius in pixels, merge time in seconds and max number of the emitters of one cluster
+constexpr float BURST_MERGE_RADIUS = 48.0f;
+constexpr float BURST_MERGE_TIME = 0.25f;
+constexpr int BURST_MAX_EMITTERS = 4;
+
+// Input latency: events in flight between the capture and the present, measured events of the overlay
+constexpr uint32_t INPUT_IN_FLIGHT = 256;
+constexpr int INPUT_HISTORY = 128;
+
+// Frame pacing: target rates switched by the "F4" key (zero is the unlocked rate), bounds of the spin margin
+// before the deadline in microseconds, late periods, which reset the schedule, and frames of the jitter history
+constexpr int FRAME_RATES[] = { 60, 120, 0 };
+constexpr int PACER_MIN_SPIN_US = 200;
+constexpr int PACER_MAX_SPIN_US = 4000;
+constexpr int PACER_MAX_LATE_PERIODS = 3;
+constexpr int PACER_HISTORY = 128;
+
+// Trail params: positions of every trail (power of two), max number of trails, width in pixels
+constexpr int TRAIL_LENGTH = 16;
+constexpr int TRAIL_CAPACITY = 4096;
+constexpr float TRAIL_WIDTH = 3.0f;
 
 // Salute gun params
-extern const std::string GUN_TEXTURE;
+constexpr char GUN_TEXTURE[] = "SaluteGun";
 extern const int GUN_VELOCITY;
 extern const float HAND_SHOT_PERIOD;
 extern const float SHOT_PERIOD;
+// Number of the salute guns along the skyline
+extern const int BATTERY_SIZE;
+// Show, which is played by the "F7" key (without extension)
+extern const std::string SHOW_FILE;
+
+// Duration of the dumped profiler trace in seconds
+extern const float TRACE_DURATION;
+
+// Saved state of the world in the write directory, it is written by the "F5" key and by the autosave
+// and restored by the "F6" key
+extern const std::string SAVE_FILE;
+// Period of the autosave in seconds
+extern const float AUTOSAVE_PERIOD;
+
+// Period of the metrics export in seconds
+extern const float METRICS_PERIOD;
+// Address of the local statsd collector
+extern const std::string STATSD_HOST;
+extern const int STATSD_PORT;
 
 // Component's textures
 extern const std::string CURSOR_TEXTURE;
@@ -79,11 +145,18 @@ extern const std::string TYPE_SWITCHER;
 extern const std::string CONTINUE_SWITCHER;
 extern const std::string EXIT_SWITCHER;
 
+// Names of the resources are hashed at compile time (ResourceIds.h)
 // Effects
-extern const std::string FLY_ROCKET_EFFECT;
-extern const std::string SHOT_EFFECT;
-extern const std::string SALUTE_EFFECT;
-extern const std::string SALUTE_TYPE_FORTH;
+constexpr char FLY_ROCKET_EFFECT[] = "FlyRocket";
+constexpr char SHOT_EFFECT[] = "Shot";
+// Sounds
+constexpr char SHOT_SOUND[] = "ShotSound";
+constexpr char SALUTE_SOUND[] = "SaluteSound";
+// Salute types, the names of the first three are the names of their burst effects
+constexpr char SALUTE_TYPE_FIRST[] = "Salute1";
+constexpr char SALUTE_TYPE_SECOND[] = "Salute2";
+constexpr char SALUTE_TYPE_THIRD[] = "Salute3";
+constexpr char SALUTE_TYPE_FORTH[] = "Mix";
 
 // Class to get params
 class Config
@@ -109,4 +182,27 @@ public:
 
     // Window's height
     static int WinHeight();
+
+    // Directory for the files, which are written by the game
+    static const std::string& WriteDirectory();
+    static void SetWriteDirectory(const std::string& path);
+
+    // Directory of the game files, which is mounted for the engine too
+    static const std::string& BaseDirectory();
+    static void SetBaseDirectory(const std::string& path);
+
+    // Shared memory of the simulation server, which is drawn instead of the own simulation.
+    // Empty name means the own simulation.
+    static const std::string& SharedWorld();
+    static void SetSharedWorld(const std::string& name);
+
+    // Flag to restore the saved state at the start, e.g. after the crash
+    static bool ResumeState();
+    static void SetResumeState(bool resume);
+
+private:
+    static std::string mWriteDirectory;
+    static std::string mBaseDirectory;
+    static std::string mSharedWorld;
+    static bool mResumeState;
 };
@@ -0,0 +1,176 @@
+/**
+ * \file
+ * \brief Implementation of the performance overlay
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "PerfHud.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "FramePacer.h"
+#include "InputLatency.h"
+#include "Metrics.h"
+#include "Params.h"
+
+
+namespace components
+{
+
+// Position and size of the overlay
+static const int HUD_X = 15;
+static const int HUD_LINE = 18;
+static const int HUD_SPARK_HEIGHT = 40;
+// Frame time in ms, which fills the sparkline height
+static const float HUD_SPARK_SCALE = 33.3f;
+// Color of the sparkline bars, 0xAARRGGBB
+static const unsigned long HUD_SPARK_COLOR = 0xC8FFFF00;
+// Vertices of the sparkline: four per bar and two degenerate ones between the bars
+static const int HUD_SPARK_VERTICES = HUD_HISTORY * 4 + (HUD_HISTORY - 1) * 2;
+// Period of the text update in seconds
+static const float HUD_TEXT_PERIOD = 0.25f;
+
+PerfHud::PerfHud()
+    : mHistoryPos(0),
+    mFrames(0),
+    mPrevTime(std::chrono::steady_clock::now()),
+    mShow(false),
+    mTextTime(mPrevTime - std::chrono::seconds(1))
+{
+    mHistory.fill(0.0f);
+    mSparkVertices.reserve(HUD_SPARK_VERTICES);
+}
+
+PerfHud& PerfHud::Instance()
+{
+    static PerfHud hud_instance;
+    return hud_instance;
+}
+
+float PerfHud::Percentile(float part) const
+{
+    int count = std::min(mFrames, HUD_HISTORY);
+    if (!count)
+        return 0.0f;
+
+    std::array<float, HUD_HISTORY> sorted = mHistory;
+    int idx = std::min(count - 1, static_cast<int>(part * count));
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.begin() + count);
+    return sorted[idx];
+}
+
+void PerfHud::Draw()
+{
+    static auto& frame_histogram = metrics::Registry::Instance().GetHistogram("frame.time_us");
+    auto curr_time = std::chrono::steady_clock::now();
+    float frame_ms = std::chrono::duration<float, std::milli>(curr_time - mPrevTime).count();
+    frame_histogram.Record(static_cast<uint64_t>(frame_ms * 1000.0f));
+    mPrevTime = curr_time;
+    auto curr_allocs = memory::ThreadStats();
+    mFrameAllocs = curr_allocs - mPrevAllocs;
+    mPrevAllocs = curr_allocs;
+    mHistory[mHistoryPos] = frame_ms;
+    mHistoryPos = (mHistoryPos + 1) % HUD_HISTORY;
+    ++mFrames;
+
+    if (!mShow)
+        return;
+
+    if (std::chrono::duration<float>(curr_time - mTextTime).count() >= HUD_TEXT_PERIOD)
+    {
+        UpdateText(frame_ms);
+        mTextTime = curr_time;
+    }
+
+    int y = Config::WinHeight() - HUD_LINE;
+    DrawSparkline(HUD_X, y - HUD_SPARK_HEIGHT);
+    y -= HUD_SPARK_HEIGHT + HUD_LINE;
+
+    // Lines are left aligned, the run is drawn by its center
+    for (auto& line : mLines)
+    {
+        line.Draw(HUD_X + line.Width() / 2, y);
+        y -= HUD_LINE;
+    }
+}
+
+void PerfHud::UpdateText(float frame_ms)
+{
+    int count = std::min(mFrames, HUD_HISTORY);
+    float average = 0.0f;
+    for (int i = 0; i < count; i++)
+        average += mHistory[i];
+    average /= count;
+
+    int rockets = 0;
+    for (int level_rockets : mStats.mLevelRockets)
+        rockets += level_rockets;
+
+    char lines[HUD_TEXT_LINES][128];
+    snprintf(lines[0], sizeof(lines[0]), "Frame %.2f ms  avg %.2f ms  p99 %.2f ms",
+             frame_ms, average, Percentile(0.99f));
+    snprintf(lines[1], sizeof(lines[1]), "Rockets %d  by level %d / %d / %d / %d+",
+             rockets, mStats.mLevelRockets[0], mStats.mLevelRockets[1],
+             mStats.mLevelRockets[2], mStats.mLevelRockets[3]);
+    snprintf(lines[2], sizeof(lines[2]), "Effects %d  particles %d", mStats.mEffects, mStats.mParticles);
+    snprintf(lines[3], sizeof(lines[3]), "Voices %d  merged bursts %llu  saved particles %llu", mStats.mVoices,
+             static_cast<unsigned long long>(mStats.mMergedBursts),
+             static_cast<unsigned long long>(mStats.mSavedParticles));
+    auto& input_latency = input::LatencyTracker::Instance();
+    snprintf(lines[4], sizeof(lines[4]), "Input to present p50 %.1f ms  p99 %.1f ms",
+             input_latency.Percentile(0.5f), input_latency.Percentile(0.99f));
+    auto& pacer = pacing::FramePacer::Instance();
+    if (pacer.TargetRate())
+        snprintf(lines[5], sizeof(lines[5]), "Pacing %d Hz  jitter p50 %.2f ms  p99 %.2f ms  late %llu  spin %.1f ms",
+                 pacer.TargetRate(), pacer.JitterPercentile(0.5f), pacer.JitterPercentile(0.99f),
+                 static_cast<unsigned long long>(pacer.LateFrames()), pacer.SpinMargin());
+    else
+        snprintf(lines[5], sizeof(lines[5]), "Pacing unlocked");
+#if defined(SALUTE_TRACK_ALLOCS)
+    snprintf(lines[6], sizeof(lines[6]), "Allocations %llu  bytes %llu per frame",
+             static_cast<unsigned long long>(mFrameAllocs.mCount),
+             static_cast<unsigned long long>(mFrameAllocs.mBytes));
+#else
+    snprintf(lines[6], sizeof(lines[6]), "Allocations are not tracked");
+#endif
+
+    // Only the changed lines are rendered again
+    for (int i = 0; i < HUD_TEXT_LINES; i++)
+    {
+        mLineText.assign(lines[i]);
+        mLines[i].Bake(mLineText, 1.0f);
+    }
+}
+
+void PerfHud::DrawSparkline(int x, int y)
+{
+    // Bars are joined by degenerate triangles, so the sparkline is one strip
+    mSparkVertices.clear();
+    for (int i = 0; i < HUD_HISTORY; i++)
+    {
+        float frame_ms = mHistory[(mHistoryPos + i) % HUD_HISTORY];
+        int height = static_cast<int>(std::min(1.0f, frame_ms / HUD_SPARK_SCALE) * HUD_SPARK_HEIGHT);
+        float left = static_cast<float>(x + 2 * i);
+        float right = left + 1.0f;
+        float bottom = static_cast<float>(y);
+        float top = bottom + std::max(height, 1);
+        if (i)
+        {
+            mSparkVertices.push_back(mSparkVertices.back());
+            mSparkVertices.push_back({ left, bottom, 0.0f, HUD_SPARK_COLOR, 0.0f, 0.0f });
+        }
+        mSparkVertices.push_back({ left, bottom, 0.0f, HUD_SPARK_COLOR, 0.0f, 0.0f });
+        mSparkVertices.push_back({ left, top, 0.0f, HUD_SPARK_COLOR, 0.0f, 0.0f });
+        mSparkVertices.push_back({ right, bottom, 0.0f, HUD_SPARK_COLOR, 0.0f, 0.0f });
+        mSparkVertices.push_back({ right, top, 0.0f, HUD_SPARK_COLOR, 0.0f, 0.0f });
+    }
+
+    Render::device.SetTexturing(false);
+    Render::device.DrawStrip(mSparkVertices.data(), static_cast<int>(mSparkVertices.size()));
+    Render::device.SetTexturing(true);
+}
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * \file
+ * \brief On-screen overlay with the performance counters
+ * \author Maksimovskiy A.S.
+ */
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "AllocTracker.h"
+#include "Components.h"
+
+
+namespace components
+{
+
+// Number of chain levels shown by the overlay, deeper levels are added to the last one
+constexpr int HUD_LEVELS = 4;
+// Number of frames in the frame time history
+constexpr int HUD_HISTORY = 128;
+// Number of text lines of the overlay
+constexpr int HUD_TEXT_LINES = 7;
+
+// Counters of the drawn world
+struct ViewStats
+{
+    // Live rockets by chain level
+    std::array<int, HUD_LEVELS> mLevelRockets = {};
+    // Active particle effects
+    int mEffects = 0;
+    // Particles of the active effects
+    int mParticles = 0;
+    // Bursts, which were merged into the clusters, and particles of their effects
+    uint64_t mMergedBursts = 0;
+    uint64_t mSavedParticles = 0;
+    // Playing sounds
+    int mVoices = 0;
+};
+
+// Singleton overlay with the frame time and the counters of the world.
+class PerfHud
+{
+public:
+    // Instance
+    static PerfHud& Instance();
+
+    // Drawing overlay. It is called once per frame after all widgets.
+    void Draw();
+
+    // Set counters of the drawn world
+    void SetViewStats(const ViewStats& stats) { mStats = stats; }
+
+    // Show or hide overlay
+    void Toggle() { mShow = !mShow; }
+
+private:
+    PerfHud();
+    PerfHud(const PerfHud&) = delete;
+    PerfHud& operator=(PerfHud&) = delete;
+
+    // Draw the frame time history as bars
+    void DrawSparkline(int x, int y);
+
+    // Format the text lines and bake the changed ones
+    void UpdateText(float frame_ms);
+
+    // Frame time percentile in ms
+    float Percentile(float part) const;
+
+    // Heap allocations of the render thread during the last frame
+    memory::AllocStats mFrameAllocs;
+    // Heap allocations of the render thread at the previous frame
+    memory::AllocStats mPrevAllocs;
+    // Frame times in ms
+    std::array<float, HUD_HISTORY> mHistory;
+    // Position for the next frame time
+    int mHistoryPos;
+    // Number of measured frames
+    int mFrames;
+    // Time of the previous frame
+    std::chrono::steady_clock::time_point mPrevTime;
+    // Show mode flag
+    bool mShow;
+    // Counters of the drawn world
+    ViewStats mStats;
+    // Baked text lines, they are formatted with the limited rate
+    std::array<TextRun, HUD_TEXT_LINES> mLines;
+    // Buffer of the formatted line, it keeps its capacity
+    std::string mLineText;
+    // Time of the last text update
+    std::chrono::steady_clock::time_point mTextTime;
+    // Vertices of the sparkline strip
+    std::vector<Render::QuadVert> mSparkVertices;
+};
+
+}
@@ -0,0 +1,236 @@
+/**
+ * \file
+ * \brief Implementation of the timing zones
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "Profiler.h"
+
+#include "AllocTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+
+namespace profiler
+{
+
+namespace
+{
+
+// Number of zones, which are kept for every thread
+constexpr size_t RING_SIZE = 1 << 16;
+
+// Finished zone
+struct ZoneRecord
+{
+    const char* mName;
+    uint64_t mStart;
+    uint64_t mEnd;
+    // Heap allocations inside the zone
+    uint64_t mAllocs;
+};
+
+// Ring buffer of the thread. It is written only by its thread, the record is published
+// by the release store of the count, so the reader checks the count after the copy.
+struct ThreadBuffer
+{
+    ZoneRecord mRecords[RING_SIZE];
+    std::atomic<uint64_t> mCount{ 0 };
+    uint32_t mThreadId = 0;
+    const char* mName = "Thread";
+};
+
+// Pair of the time stamp counter and the steady clock to convert ticks into microseconds
+struct ClockPoint
+{
+    uint64_t mTicks;
+    std::chrono::steady_clock::time_point mTime;
+
+    static ClockPoint Now()
+    {
+        return { __rdtsc(), std::chrono::steady_clock::now() };
+    }
+};
+
+// Zones of one thread, which were copied for the trace
+struct ThreadSnapshot
+{
+    uint32_t mThreadId;
+    const char* mName;
+    std::vector<ZoneRecord> mRecords;
+};
+
+// Buffers of all threads, which have ever recorded a zone
+struct Registry
+{
+    ~Registry()
+    {
+        if (mWriter.joinable())
+            mWriter.join();
+    }
+
+    std::mutex mMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> mBuffers;
+    ClockPoint mOrigin = ClockPoint::Now();
+    // Thread, which writes the last trace, and the flag of the writing
+    std::thread mWriter;
+    std::atomic<bool> mWriting{ false };
+};
+
+Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+ThreadBuffer& GetThreadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        auto& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mMutex);
+        registry.mBuffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = registry.mBuffers.back().get();
+        buffer->mThreadId = static_cast<uint32_t>(registry.mBuffers.size());
+    }
+    return *buffer;
+}
+
+}
+
+Zone::Zone(const char* name)
+    : mName(name),
+    mStart(__rdtsc()),
+    mStartAllocs(memory::ThreadStats().mCount)
+{
+}
+
+Zone::~Zone()
+{
+    uint64_t end = __rdtsc();
+    auto& buffer = GetThreadBuffer();
+    uint64_t count = buffer.mCount.load(std::memory_order_relaxed);
+    buffer.mRecords[count % RING_SIZE] = { mName, mStart, end, memory::ThreadStats().mCount - mStartAllocs };
+    buffer.mCount.store(count + 1, std::memory_order_release);
+}
+
+void SetThreadName(const char* name)
+{
+    GetThreadBuffer().mName = name;
+}
+
+namespace
+{
+
+// Copy the zones, which were started after the tick. Records, which were overwritten
+// by their thread during the copy, are dropped.
+void CopyRecords(const ThreadBuffer& buffer, uint64_t from_ticks, std::vector<ZoneRecord>& records)
+{
+    uint64_t count = buffer.mCount.load(std::memory_order_acquire);
+    uint64_t first_record = count > RING_SIZE ? count - RING_SIZE : 0;
+    for (uint64_t i = first_record; i < count; i++)
+        records.push_back(buffer.mRecords[i % RING_SIZE]);
+
+    // The thread could write the records up to new_count and the unpublished one over
+    // the oldest records, so the records before (new_count + 1 - RING_SIZE) are not valid
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t new_count = buffer.mCount.load(std::memory_order_relaxed);
+    uint64_t valid_record = new_count + 1 > RING_SIZE ? new_count + 1 - RING_SIZE : 0;
+    uint64_t overwritten = std::min<uint64_t>(records.size(), valid_record > first_record ? valid_record - first_record : 0);
+    records.erase(records.begin(), records.begin() + static_cast<ptrdiff_t>(overwritten));
+    records.erase(std::remove_if(records.begin(), records.end(), [from_ticks](const ZoneRecord& record)
+    {
+        return record.mStart < from_ticks;
+    }), records.end());
+}
+
+bool WriteTrace(const std::string& path, const std::vector<ThreadSnapshot>& threads,
+                uint64_t origin_ticks, double ticks_per_us)
+{
+    std::ofstream out(path, std::ios::trunc);
+    bool first = true;
+    auto separator = [&out, &first]()
+    {
+        if (!first)
+            out << ",\n";
+        first = false;
+    };
+
+    out << "{\"traceEvents\":[\n";
+    for (auto& thread : threads)
+    {
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.mThreadId
+            << ",\"args\":{\"name\":\"" << thread.mName << "\"}}";
+
+        for (auto& record : thread.mRecords)
+        {
+            separator();
+            out << "{\"name\":\"" << record.mName << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.mThreadId
+                << ",\"ts\":" << (record.mStart - origin_ticks) / ticks_per_us
+                << ",\"dur\":" << (record.mEnd - record.mStart) / ticks_per_us
+                << ",\"args\":{\"allocs\":" << record.mAllocs << "}}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(out);
+}
+
+}
+
+bool DumpTrace(const std::string& path, float seconds)
+{
+    auto& registry = GetRegistry();
+    if (registry.mWriting.exchange(true))
+        return false;
+    if (registry.mWriter.joinable())
+        registry.mWriter.join();
+
+    // Ticks per microsecond since the start of the application
+    auto now = ClockPoint::Now();
+    double elapsed_us = std::chrono::duration<double, std::micro>(now.mTime - registry.mOrigin.mTime).count();
+    double ticks_per_us = elapsed_us > 0.0 ? (now.mTicks - registry.mOrigin.mTicks) / elapsed_us : 1.0;
+    uint64_t from_ticks = now.mTicks - static_cast<uint64_t>(seconds * 1e6 * ticks_per_us);
+
+    // The zones are copied here, the threads go on recording
+    std::vector<ThreadSnapshot> threads;
+    {
+        std::lock_guard<std::mutex> lock(registry.mMutex);
+        threads.resize(registry.mBuffers.size());
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            auto& buffer = *registry.mBuffers[i];
+            threads[i].mThreadId = buffer.mThreadId;
+            threads[i].mName = buffer.mName;
+            CopyRecords(buffer, from_ticks, threads[i].mRecords);
+        }
+    }
+
+    // The file is written by the background thread, so the frame is not stalled
+    uint64_t origin_ticks = registry.mOrigin.mTicks;
+    registry.mWriter = std::thread([&registry, path, origin_ticks, ticks_per_us](std::vector<ThreadSnapshot> threads)
+    {
+        if (!WriteTrace(path, threads, origin_ticks, ticks_per_us))
+            Log::log.WriteError("Can not write the trace " + path);
+        registry.mWriting.store(false);
+    }, std::move(threads));
+    return true;
+}
+
+}
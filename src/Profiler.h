@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Scoped timing zones with export to the Chrome trace format
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+#include <string>
+
+// Zones are compiled only with SALUTE_PROFILING
+#if defined(SALUTE_PROFILING)
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) profiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_THREAD(name) profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#endif
+
+
+namespace profiler
+{
+
+// Timing zone of the current thread. Name must be a string literal.
+class Zone
+{
+public:
+    explicit Zone(const char* name);
+    ~Zone();
+
+private:
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+    const char* mName;
+    uint64_t mStart;
+    uint64_t mStartAllocs;
+};
+
+// Name of the current thread in the trace
+void SetThreadName(const char* name);
+
+// Copy zones of the last seconds of all threads and write them into the Chrome trace (JSON) file
+// by the background thread. Returns false if the previous trace is still being written.
+bool DumpTrace(const std::string& path, float seconds);
+
+}
@@ -0,0 +1,66 @@
+/**
+ * \file
+ * \brief Implementation of the registry of the resource names
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "ResourceIds.h"
+
+
+namespace res
+{
+
+Registry& Registry::Instance()
+{
+    static Registry registry_instance;
+    return registry_instance;
+}
+
+Registry::Registry()
+{
+    for (auto name : KNOWN_NAMES)
+        Register(name);
+}
+
+Handle Registry::Find(Id id) const
+{
+    auto found = mHandles.find(id);
+    return found == mHandles.end() ? NO_HANDLE : found->second;
+}
+
+Handle Registry::Register(const std::string& name)
+{
+    Id id = Hash(name.c_str());
+    Handle handle = Find(id);
+    if (handle != NO_HANDLE)
+    {
+        if (mNames[handle] == name)
+            return handle;
+
+        Log::log.WriteError("Resource " + name + " has the same id as " + mNames[handle]);
+        return NO_HANDLE;
+    }
+
+    if (mNames.size() >= NO_HANDLE)
+        return NO_HANDLE;
+
+    handle = static_cast<Handle>(mNames.size());
+    mNames.push_back(name);
+    mTextures.push_back(nullptr);
+    mHandles.emplace(id, handle);
+    return handle;
+}
+
+Render::Texture* Registry::Texture(Handle handle)
+{
+    if (handle >= mNames.size())
+        return nullptr;
+
+    if (!mTextures[handle])
+        mTextures[handle] = Core::resourceManager.Get<Render::Texture>(mNames[handle]);
+    return mTextures[handle];
+}
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Compile-time ids of the resource names and the registry of their handles
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Params.h"
+
+
+namespace res
+{
+
+// 32-bit FNV-1a hash of the resource name
+using Id = uint32_t;
+// Index of the registered name
+using Handle = uint16_t;
+
+constexpr Handle NO_HANDLE = 0xFFFF;
+
+constexpr Id Hash(const char* name)
+{
+    Id hash = 2166136261u;
+    for (; *name; ++name)
+    {
+        hash ^= static_cast<uint8_t>(*name);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Names from Params, which are registered first, so their handles are known at compile time
+enum KnownHandle : Handle
+{
+    FLY_ROCKET_HANDLE,
+    SHOT_HANDLE,
+    SHOT_SOUND_HANDLE,
+    SALUTE_SOUND_HANDLE,
+    SALUTE_FIRST_HANDLE,
+    SALUTE_SECOND_HANDLE,
+    SALUTE_THIRD_HANDLE,
+    SALUTE_MIX_HANDLE,
+    GUN_TEXTURE_HANDLE,
+    KNOWN_HANDLE_COUNT
+};
+
+constexpr const char* KNOWN_NAMES[KNOWN_HANDLE_COUNT] =
+{
+    FLY_ROCKET_EFFECT,
+    SHOT_EFFECT,
+    SHOT_SOUND,
+    SALUTE_SOUND,
+    SALUTE_TYPE_FIRST,
+    SALUTE_TYPE_SECOND,
+    SALUTE_TYPE_THIRD,
+    SALUTE_TYPE_FORTH,
+    GUN_TEXTURE
+};
+
+// Effects of the bursts, the mixed salute takes one of them randomly
+constexpr Handle SALUTE_EFFECT_HANDLES[] = { SALUTE_FIRST_HANDLE, SALUTE_SECOND_HANDLE, SALUTE_THIRD_HANDLE };
+constexpr int SALUTE_EFFECT_COUNT = sizeof(SALUTE_EFFECT_HANDLES) / sizeof(SALUTE_EFFECT_HANDLES[0]);
+
+// Check that the known names have different ids
+constexpr bool UniqueIds(const char* const* names, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        for (size_t j = i + 1; j < count; j++)
+            if (Hash(names[i]) == Hash(names[j]))
+                return false;
+    return true;
+}
+
+static_assert(UniqueIds(KNOWN_NAMES, KNOWN_HANDLE_COUNT), "Ids of the resource names must be unique");
+
+//------------------------------------------------------------------------------------
+// Registry of the resource names. The name is hashed and resolved once,
+// then only its handle is passed through the game.
+// It is used by the render thread, the simulation only copies the handles.
+class Registry
+{
+public:
+    // Instance
+    static Registry& Instance();
+
+    // Handle of the name, the new name is registered.
+    // Returns NO_HANDLE if the id of the name is taken by another name.
+    Handle Register(const std::string& name);
+
+    // Handle of the registered id or NO_HANDLE
+    Handle Find(Id id) const;
+
+    // Name of the handle
+    const std::string& Name(Handle handle) const { return mNames[handle]; }
+
+    // Number of the registered names
+    size_t Count() const { return mNames.size(); }
+
+    // Texture of the handle. It is taken from the resource manager only once.
+    Render::Texture* Texture(Handle handle);
+
+private:
+    Registry();
+    Registry(const Registry&) = delete;
+    Registry& operator=(Registry&) = delete;
+
+    std::vector<std::string> mNames;
+    std::vector<Render::Texture*> mTextures;
+    std::unordered_map<Id, Handle> mHandles;
+};
+
+}
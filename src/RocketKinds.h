@@ -0,0 +1,84 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Kinds of rockets with coefficients, which are computed at compile time
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+
+#include "Params.h"
+
+
+namespace weapons
+{
+
+namespace detail
+{
+
+constexpr double KIND_PI = 3.14159265358979323846;
+
+// exp(x) by the Taylor series. It is precise enough for |x| < 1.
+constexpr double Exp(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int n = 1; n < 24; n++)
+    {
+        term *= x / n;
+        sum += term;
+    }
+    return sum;
+}
+
+}
+
+// Physical description of the rocket kind
+struct RocketKind
+{
+    // Drag param
+    float mCm;
+    // Swift param
+    float mKm;
+    // Acceleration by the wind per unit of the wind speed
+    float mWindDrag;
+    // Start velocity of the main rocket, sub-rockets fly with the half of it
+    int mVelocity;
+    // Texture of the rocket
+    const char* mTexture;
+};
+
+// Calculate the kind coefficients (see Rocket::Move)
+constexpr RocketKind MakeRocketKind(float rpm, float s, float mass, float wind_drag, int velocity,
+                                    const char* texture)
+{
+    // Convert to rad/s
+    double w = rpm * detail::KIND_PI / 30.0;
+    // Drag coefficient
+    double cd = 0.30 + 2.58e-4 * w;
+    // Swift factor
+    double cl = 0.3187 * (1.0 - detail::Exp(-2.483e-3 * w));
+    return { static_cast<float>(0.5 * cd * s * RHO / mass),
+             static_cast<float>(0.5 * cl * s * RHO / mass),
+             wind_drag, velocity, texture };
+}
+
+// Index of the rocket kind in the table
+enum RocketKindId : uint8_t
+{
+    RED_ROCKET,
+
+    ROCKET_KIND_COUNT
+};
+
+// Table of the rocket kinds. New kind needs only a new line here and in RocketKindId.
+constexpr RocketKind ROCKET_KINDS[] =
+{
+    MakeRocketKind(ROCKET_RPM, ROCKET_S, ROCKET_MASS, ROCKET_WIND_DRAG, ROCKET_VELOCITY, ROCKET_TEXTURE)
+};
+
+static_assert(sizeof(ROCKET_KINDS) / sizeof(ROCKET_KINDS[0]) == ROCKET_KIND_COUNT,
+              "Every rocket kind must be described in the table");
+
+}
@@ -0,0 +1,216 @@
+/**
+ * \file
+ * \brief Implementation of the battery of salute guns
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "SaluteBattery.h"
+
+#include <algorithm>
+#include <ctime>
+#include <thread>
+
+#include "AimSolver.h"
+#include "AllocTracker.h"
+#include "Profiler.h"
+
+
+namespace weapons
+{
+
+SaluteBattery::SaluteBattery()
+    : mClock(&utils::WallClock::Instance())
+{
+    auto& registry = res::Registry::Instance();
+    for (auto& type : Config::SaluteTypes())
+        mSaluteTypes.push_back(registry.Register(type.first));
+    Init(1, 0, 0, 0, Config::WinWidth(), static_cast<unsigned>(time(0)));
+}
+
+void SaluteBattery::Init(size_t count, int width, int height, int min, int max, unsigned seed)
+{
+    count = std::max<size_t>(count, 1);
+    mGuns.clear();
+    mSlotEnds.clear();
+    mGunAllocs.assign(count, 0);
+
+    // Slots divide the whole window, the first ones are cut by the min position.
+    // Every gun stands in the middle of its slot.
+    int win_width = Config::WinWidth();
+    for (size_t i = 0; i < count; i++)
+    {
+        int slot_begin = static_cast<int>(win_width * i / count);
+        int slot_end = static_cast<int>(win_width * (i + 1) / count);
+        auto gun = std::make_unique<SaluteGun>(seed + static_cast<unsigned>(i));
+        gun->SetClock(mClock);
+        gun->InitSize(width, height);
+        gun->InitIds(static_cast<uint32_t>(i + 1), static_cast<uint32_t>(count));
+        gun->InitMinMaxPos(std::max(slot_begin, min), std::min(slot_end, max));
+        gun->SetCapacity(ROCKET_CAPACITY / count);
+        gun->SetPosition((slot_begin + slot_end - width) / 2);
+        mGuns.push_back(std::move(gun));
+        mSlotEnds.push_back(slot_end);
+    }
+
+    // Tables of the aim solver are built before the simulation thread, which must not allocate memory
+    for (int kind = 0; kind < ROCKET_KIND_COUNT; kind++)
+        AimSolver::Instance(static_cast<RocketKindId>(kind));
+
+    // The simulation thread steps guns too
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    mWorkers.Resize(std::min(count, cores) - 1);
+}
+
+void SaluteBattery::InitRockets(bool restart)
+{
+    for (auto& gun : mGuns)
+        gun->InitRockets(restart);
+}
+
+void SaluteBattery::Move(bool is_left)
+{
+    for (auto& gun : mGuns)
+        gun->Move(is_left);
+}
+
+bool SaluteBattery::Launch(const show::ShowLaunch& launch)
+{
+    if (launch.mSaluteType >= mSaluteTypes.size())
+        return false;
+
+    auto& gun = mGuns[launch.mGun % mGuns.size()];
+    return gun->Launch(launch.mAngle, mSaluteTypes[launch.mSaluteType], launch.mDepth);
+}
+
+bool SaluteBattery::MouseShot(int x, int y)
+{
+    auto slot = std::upper_bound(mSlotEnds.begin(), mSlotEnds.end(), x);
+    if (slot == mSlotEnds.end())
+        --slot;
+    return mGuns[slot - mSlotEnds.begin()]->MouseShot(x, y);
+}
+
+void SaluteBattery::OnPausedMoving(bool pause)
+{
+    for (auto& gun : mGuns)
+        gun->OnPausedMoving(pause);
+}
+
+void SaluteBattery::Publish(WorldSnapshot& snapshot) const
+{
+    snapshot.mGunX.clear();
+    snapshot.mRockets.clear();
+    for (auto& gun : mGuns)
+        gun->Publish(snapshot);
+}
+
+void SaluteBattery::SetAimMode(bool enabled)
+{
+    for (auto& gun : mGuns)
+        gun->SetAimMode(enabled);
+}
+
+void SaluteBattery::SetAutoShot(bool enabled)
+{
+    for (auto& gun : mGuns)
+        gun->SetAutoShot(enabled);
+}
+
+void SaluteBattery::SetEffect(res::Handle effect)
+{
+    for (auto& gun : mGuns)
+        gun->SetEffect(effect);
+}
+
+void SaluteBattery::SetFanOut(int fan_out)
+{
+    for (auto& gun : mGuns)
+        gun->SetFanOut(fan_out);
+}
+
+void SaluteBattery::SetLevelLimit(int limit)
+{
+    for (auto& gun : mGuns)
+        gun->SetLevelLimit(limit);
+}
+
+void SaluteBattery::SetClock(const utils::Clock* clock)
+{
+    mClock = clock;
+    for (auto& gun : mGuns)
+        gun->SetClock(clock);
+}
+
+void SaluteBattery::SetWind(const WindField* wind)
+{
+    for (auto& gun : mGuns)
+        gun->SetWind(wind);
+}
+
+void SaluteBattery::Shot(bool forced)
+{
+    for (auto& gun : mGuns)
+        gun->Shot(forced);
+}
+
+void SaluteBattery::ResetHandShot()
+{
+    for (auto& gun : mGuns)
+        gun->ResetHandShot();
+}
+
+void SaluteBattery::Save(save::Writer& writer) const
+{
+    writer.Pod(static_cast<uint64_t>(mGuns.size()));
+    for (auto& gun : mGuns)
+        gun->Save(writer);
+}
+
+bool SaluteBattery::Restore(save::Reader& reader, size_t handle_count)
+{
+    uint64_t count = 0;
+    if (!reader.Pod(count) || !count || count > ROCKET_CAPACITY)
+        return false;
+
+    // Capacity of the guns after Init
+    std::vector<SavedGun> saved(static_cast<size_t>(count));
+    for (auto& gun : saved)
+    {
+        if (!SaluteGun::Decode(reader, ROCKET_CAPACITY / saved.size(), handle_count, gun))
+            return false;
+    }
+    if (!reader.IsFinished())
+        return false;
+
+    // Positions, sizes and seeds of the new guns are restored from the state
+    if (saved.size() != mGuns.size())
+        Init(saved.size(), 0, 0, 0, Config::WinWidth(), 0);
+    for (size_t i = 0; i < mGuns.size(); i++)
+        mGuns[i]->Restore(saved[i]);
+    return true;
+}
+
+uint64_t SaluteBattery::WorkerAllocs() const
+{
+    uint64_t allocs = 0;
+    for (auto count : mGunAllocs)
+        allocs += count;
+    return allocs;
+}
+
+void SaluteBattery::Update(float dt)
+{
+    PROFILE_ZONE("SaluteBattery::Update");
+    auto caller = std::this_thread::get_id();
+    auto step = [this, dt, caller](size_t index)
+    {
+        auto start_allocs = memory::ThreadStats();
+        mGuns[index]->Update(dt);
+        mGunAllocs[index] = std::this_thread::get_id() != caller ? (memory::ThreadStats() - start_allocs).mCount : 0;
+    };
+    mWorkers.Run(mGuns.size(), step);
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Battery of salute guns, which are stepped in parallel
+ * \author Maksimovskiy A.S.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "Concurrency.h"
+#include "SaluteGun.h"
+#include "ShowTimeline.h"
+
+
+namespace weapons
+{
+
+// Class owns the guns along the skyline. Every gun has its own slot of the skyline,
+// its own rockets, timers and random generator, so the guns are stepped
+// on the worker threads without locks. Their output is merged in the gun order.
+class SaluteBattery
+{
+public:
+    SaluteBattery();
+    ~SaluteBattery() = default;
+
+    // Number of the guns
+    size_t Count() const { return mGuns.size(); }
+
+    // Gun by index
+    SaluteGun& Gun(size_t index) { return *mGuns[index]; }
+
+    // Create the guns and divide the range [min, max] and the rocket capacity between them.
+    // Random generators of the guns are seeded by seed, seed + 1...
+    void Init(size_t count, int width, int height, int min, int max, unsigned seed);
+
+    // Commands for all guns
+    void InitRockets(bool restart = false);
+    void Move(bool is_left = true);
+    void OnPausedMoving(bool pause = true);
+    void SetAimMode(bool enabled);
+    void SetAutoShot(bool enabled);
+    void SetEffect(res::Handle effect);
+    void SetFanOut(int fan_out);
+    void SetLevelLimit(int limit);
+    void SetWind(const WindField* wind);
+    void Shot(bool forced = false);
+
+    // Allow the next hand or mouse shot of all guns at once
+    void ResetHandShot();
+
+    // Set the clock of the shot timers of all guns, it is kept for the guns of the next Init
+    void SetClock(const utils::Clock* clock);
+
+    // Launch of the show by its gun
+    bool Launch(const show::ShowLaunch& launch);
+
+    // Mouse shot by the gun, which slot contains the position
+    bool MouseShot(int x, int y);
+
+    // Add the state of all guns into the snapshot
+    void Publish(WorldSnapshot& snapshot) const;
+
+    // Write the state of all guns
+    void Save(save::Writer& writer) const;
+
+    // Restore the state of all guns, it must be the last section of the state. All guns are decoded
+    // and checked first, so the broken state does not change the battery. The handles must be less
+    // than handle_count. The battery is created again, if the number of the guns differs,
+    // then the wind must be set again. Returns false if the state is broken.
+    bool Restore(save::Reader& reader, size_t handle_count);
+
+    // Heap allocations of the guns, which were stepped by the worker threads on the last step.
+    // Allocations of the calling thread are counted by its own stats.
+    uint64_t WorkerAllocs() const;
+
+    // Step all guns in parallel
+    void Update(float dt);
+
+private:
+    SaluteBattery(const SaluteBattery&) = delete;
+    SaluteBattery& operator=(const SaluteBattery&) = delete;
+
+    // Guns of the battery
+    std::vector<std::unique_ptr<SaluteGun>> mGuns;
+
+    // Right border of the slot of every gun
+    std::vector<int> mSlotEnds;
+
+    // Salute types for the show launches
+    std::vector<res::Handle> mSaluteTypes;
+
+    // Allocations of the guns, which were stepped by the workers, on the last step
+    std::vector<uint64_t> mGunAllocs;
+
+    // Clock of the shot timers
+    const utils::Clock* mClock;
+
+    // Threads for stepping the guns
+    utils::WorkerPool mWorkers;
+};
+
+}
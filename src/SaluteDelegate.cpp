@@ -1,5 +1,10 @@
 #include "stdafx.h"
 #include "Params.h"
+#include "FramePacer.h"
+#include "InputLatency.h"
+#include "Metrics.h"
+#include "PerfHud.h"
+#include "Profiler.h"
 #include "SaluteDelegate.h"
 #include "SaluteWidget.h"
 
@@ -22,7 +27,12 @@ void SaluteDelegate::RegisterTypes()
 
 void SaluteDelegate::LoadResources()
 {
+    PROFILE_ZONE("SaluteDelegate::LoadResources");
+    auto start_time = std::chrono::steady_clock::now();
     Core::LuaExecuteStartupScript("start.lua");
+    auto load_time = std::chrono::steady_clock::now() - start_time;
+    metrics::Registry::Instance().GetGauge("loader.startup_ms").Set(
+        std::chrono::duration<double, std::milli>(load_time).count());
 }
 
 void SaluteDelegate::OnResourceLoaded() {
@@ -33,8 +43,15 @@ void SaluteDelegate::OnResourceLoaded() {
 
 void SaluteDelegate::OnPostDraw() 
 {
-    if (!Render::isFontLoaded("arial"))
-        return;
+    // The frame is drawn, so the input events of its snapshot are presented
+    input::LatencyTracker::Instance().Present();
 
-    Render::BindFont("arial");
+    if (Render::isFontLoaded("arial"))
+    {
+        Render::BindFont("arial");
+        components::PerfHud::Instance().Draw();
+    }
+
+    // The next frame starts at the deadline of the target rate
+    pacing::FramePacer::Instance().EndFrame();
 }
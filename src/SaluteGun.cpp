@@ -8,70 +8,88 @@
 
 #include "SaluteGun.h"
 
+#include <algorithm>
+#include <cmath>
 #include <corecrt_math_defines.h>
-#include <mutex>
 
+#include "AimSolver.h"
+#include "Metrics.h"
+#include "Profiler.h"
 #include "Utils.h"
 
 
 namespace weapons
 {
 
- // Time discrete
-static float TIME_DELTA = 0.1f;
-
 RocketParams::RocketParams(int x, int y, float angle, int level,
-                           const std::string& effect_name,
-                           bool is_main)
+                           res::Handle effect,
+                           bool is_main,
+                           RocketKindId kind)
     : mX(x), mY(y), mRotateAngle(angle), mLevel(level), 
-    mSaluteEffectName(effect_name), mMainRocket(is_main)
+    mEffect(effect), mMainRocket(is_main), mKind(kind)
 {
 }
 
 //------------------------------------------------------------------------------------
 // Rocket
 
-Rocket::Rocket(const RocketParams& params)
-   : mFirstDraw(false),
-    mIsPaused(false),
-    mIsUsed(false),
+namespace
+{
+
+// Counters of the random numbers of the rocket
+enum RandomCounter : uint32_t
+{
+    DISTANCE_COUNTER,
+    MIX_COUNTER,
+    INVERT_COUNTER,
+    DELTA_ANGLE_COUNTER
+};
+
+// Check the restored handle: no resource or the registered one
+bool IsHandle(res::Handle handle, size_t handle_count)
+{
+    return handle == res::NO_HANDLE || handle < handle_count;
+}
+
+}
+
+Rocket::Rocket(const RocketParams& params, uint32_t id, uint64_t seed)
+   : mId(id),
     mMainRocket(params.mMainRocket),
-    mDeltaX(0.0f),
-    mDeltaY(0.0f),
+    mEffect(params.mEffect),
+    mIsUsed(false),
     mLevel(params.mLevel),
-    mSaluteEffectName(params.mSaluteEffectName)
+    mKind(params.mKind),
+    mSaluteType(params.mSaluteType),
+    mLevelLimit(params.mLevelLimit)
 {
-    auto& inst = utils::RandomGenerator::Instance();
-    if (mMainRocket)
-        mDistance = inst.GetRealValue(MAIN_MIN_DISTANCE, MAIN_MAX_DISTANCE);
+    utils::CounterRandom random(seed, id);
+    if (params.mDistance >= 0.0f)
+        mDistance = params.mDistance;
+    else if (mMainRocket)
+        mDistance = random.GetRealValue(DISTANCE_COUNTER, MAIN_MIN_DISTANCE, MAIN_MAX_DISTANCE);
     else
-        mDistance = inst.GetRealValue(MIN_DISTANCE, MAX_DISTANCE);
+        mDistance = random.GetRealValue(DISTANCE_COUNTER, MIN_DISTANCE, MAX_DISTANCE);
     mRect.mX = params.mX;
     mRect.mY = params.mY;
     mInitRect.mX = params.mX;
     mInitRect.mY = params.mY;
     CalcAngles(params.mRotateAngle);
 
-    // Init salute name if mix type
-    if (mSaluteEffectName == SALUTE_TYPE_FORTH)
-    {
-        int type_id = inst.GetIntValue(1, Config::SaluteCount());
-        mSaluteEffectName = SALUTE_EFFECT + std::to_string(type_id);
-    }
+    // Init salute effect if mix type
+    if (mEffect == res::SALUTE_MIX_HANDLE)
+        mEffect = res::SALUTE_EFFECT_HANDLES[random.GetIntValue(MIX_COUNTER, 0, res::SALUTE_EFFECT_COUNT - 1)];
 }
 
-float* Rocket::RKFunc(float* xy_old)
+void Rocket::RKFunc(RocketKindId kind_id, const float* xy_old, float wind_x, float wind_y, float* y)
 {
-    float* y = new float[N_DIM];
-
+    const auto& kind = ROCKET_KINDS[kind_id];
     y[0] = xy_old[1];
     // Vx change
-    y[1] = -mCm * xy_old[1] - mKm * xy_old[3];
+    y[1] = -kind.mCm * xy_old[1] - kind.mKm * xy_old[3] + kind.mWindDrag * wind_x;
     y[2] = xy_old[3];
     // Vy change
-    y[3] = -G - mCm * xy_old[3] + mKm * xy_old[1];
-
-    return (y);
+    y[3] = -G - kind.mCm * xy_old[3] + kind.mKm * xy_old[1] + kind.mWindDrag * wind_y;
 }
 
 void Rocket::CalcAngles(float rotate_angle)
@@ -79,7 +97,8 @@ void Rocket::CalcAngles(float rotate_angle)
     float ang = rotate_angle * M_PI / PI_DEGREES;
 
     // Initial position, initial speed, shot angle
-    int v = !mLevel ? ROCKET_VELOCITY : ROCKET_VELOCITY / 2;
+    int velocity = ROCKET_KINDS[mKind].mVelocity;
+    int v = !mLevel ? velocity : velocity / 2;
     // x0
     mXYold[0] = mRect.mX;
     // vx0
@@ -90,17 +109,6 @@ void Rocket::CalcAngles(float rotate_angle)
     mXYold[3] = v * sin(ang);
 }
 
-bool Rocket::Clear()
-{
-    if (!mIsUsed)
-        return false;
-
-    mFlyEffect = nullptr;
-    mSaluteEffect = nullptr;
-    mTexture = nullptr;
-    return true;
-}
-
 void Rocket::CheckRocketOnUsed()
 {
     int curr_x = mRect.mX;
@@ -112,30 +120,44 @@ void Rocket::CheckRocketOnUsed()
     mIsUsed = distance >= mDistance;
 }
 
-std::list<RocketParams> Rocket::CreateSubRockets(const std::string& salute_type, int level_limit)
+int Rocket::SubRocketCount(int level_limit, int fan_out) const
 {
-    if (!mIsUsed)
-        return {};
-
-    int new_level = ++mLevel;
-    if (new_level > level_limit)
-        return {};
+    if (!mIsUsed || mLevel + 1 > (mLevelLimit < 0 ? level_limit : mLevelLimit))
+        return 0;
+    return fan_out;
+}
 
-    auto angle = acos(mXYold[3] / sqrt(mXYold[3] * mXYold[3] + mXYold[1] * mXYold[1]));
+void Rocket::CreateSubRockets(res::Handle salute_type, uint64_t seed, uint32_t first_id, uint32_t id_step,
+                              int fan_out, int count, Rocket* children) const
+{
+    utils::CounterRandom random(seed, mId);
+    // Angle between the velocity and the vertical. The acos of vy / |v| is NaN for the vertical flight,
+    // when the ratio is rounded above one.
+    auto angle = atan2(fabs(mXYold[1]), mXYold[3]);
     float real_angle = angle * PI_DEGREES / M_PI;
-    auto& inst = utils::RandomGenerator::Instance();
-    int invert = inst.GetIntValue(0, 1) ? 1 : -1;
+    int invert = random.GetIntValue(INVERT_COUNTER, 0, 1) ? 1 : -1;
     real_angle = invert * real_angle;
-    auto random_angle = inst.GetRealValue(MIN_DELTA_ANGLE, MAX_DELTA_ANGLE);
-    return { RocketParams{mRect.mX, mRect.mY, real_angle, new_level, salute_type},
-             RocketParams{mRect.mX, mRect.mY, real_angle + random_angle, new_level, salute_type},
-             RocketParams{mRect.mX, mRect.mY, real_angle - random_angle, new_level, salute_type} };
+    auto random_angle = random.GetRealValue(DELTA_ANGLE_COUNTER, MIN_DELTA_ANGLE, MAX_DELTA_ANGLE);
+    res::Handle type = mSaluteType == res::NO_HANDLE ? salute_type : mSaluteType;
+    // Sub-rockets divide the range [-random_angle, random_angle] evenly: the middle one (if any) first,
+    // then the pairs from the middle, so three sub-rockets fly by 0, random_angle and -random_angle
+    float step = fan_out > 1 ? 2.0f * random_angle / (fan_out - 1) : 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        float delta = fan_out % 2 ? (i + 1) / 2 * step : (i / 2 + 0.5f) * step;
+        if (i % 2 != fan_out % 2)
+            delta = -delta;
+        RocketParams params(mRect.mX, mRect.mY, real_angle + delta, mLevel + 1, type, false, mKind);
+        params.mSaluteType = mSaluteType;
+        params.mLevelLimit = mLevelLimit;
+        children[i] = Rocket(params, first_id + i * id_step, seed);
+    }
 }
 
-void Rocket::Move()
+bool Rocket::BeginStep()
 {
     /**
-    * In this method, the movement of the rocket is calculated as for an object launched at an angle to the horizon.
+    * The movement of the rocket is calculated as for an object launched at an angle to the horizon.
     * But in addition to the action of gravity, factors such as 
     * air resistance, angular velocity and wind action are also taken into account.
     * From the second law of Newton a = F / m, whence it follows that
@@ -159,190 +181,112 @@ void Rocket::Move()
     * k4 = dt * RK4(xy[n] + k3)
     *
     * xy - at each iteration n, this is an array of 4 elements:
-    * current x and y coordinates and velocity projections vx and vy
+    * current x and y coordinates and velocity projections vx and vy.
+    * The wind pushes the rocket with the force, which is proportional to the wind
+    * in the point of the stage, so every stage has its own wind sample.
     */
 
-    if (mIsPaused)
-        return;
-
     // If the rocket did not hit one target,
     // it is considered used when it hits the ground.
     if (mXYold[2] < -0.001)
     {
         mIsUsed = true;
-        return;
+        return false;
     }
+    return true;
+}
 
-    float y_new[N_DIM];
-    float y1[N_DIM];
-    float y2[N_DIM];
-    float y3[N_DIM];
-
-    // k1 = f(tn, yn)
-    float* k1 = RKFunc(mXYold);
-    for (int i = 0; i < N_DIM; i++)
-        y1[i] = mXYold[i] + 0.5 * TIME_DELTA * k1[i];
-
-    // k2 = f(tn + h/2, yn + k1/2)
-    float* k2 = RKFunc(y1);
-    for (int i = 0; i < N_DIM; i++)
-        y2[i] = mXYold[i] + 0.5 * TIME_DELTA * k2[i];
-
-    // k3 = f(tn + h/2, yn + k2/2)
-    float* k3 = RKFunc(y2);
-    for (int i = 0; i < N_DIM; i++)
-        y3[i] = mXYold[i] + TIME_DELTA * k3[i];
-
-    // k4 = f(tn + h/2, yn + k3)
-    float* k4 = RKFunc(y3);
-
-    for (int i = 0; i < N_DIM; i++)
-        y_new[i] = mXYold[i] + TIME_DELTA * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]) / 6.0;
-
-    mRect.mX = y_new[0];
-    mRect.mY = y_new[2];
+void Rocket::PrepareStage(int stage, float time_delta, RocketStage& scratch, float& x, float& y) const
+{
+    // k1 = f(tn, yn), k2 = f(tn + h/2, yn + k1/2), k3 = f(tn + h/2, yn + k2/2), k4 = f(tn + h, yn + k3)
+    static const float STAGE_STEP[RK_STAGES] = { 0.0f, 0.5f, 0.5f, 1.0f };
     for (int i = 0; i < N_DIM; i++)
-        mXYold[i] = y_new[i];
-
-    delete[] k1;
-    delete[] k2;
-    delete[] k3;
-    delete[] k4;
+        scratch.mPoint[i] = stage ? mXYold[i] + STAGE_STEP[stage] * time_delta * scratch.mK[stage - 1][i] : mXYold[i];
+    x = scratch.mPoint[0];
+    y = scratch.mPoint[2];
 }
 
-void Rocket::SimpleDraw()
+void Rocket::CalcStage(int stage, float wind_x, float wind_y, RocketStage& scratch) const
 {
-    if (mIsUsed || !mMainRocket)
-        return;
-
-    auto angle = acos(mXYold[3] / sqrt(mXYold[3] * mXYold[3] + mXYold[1] * mXYold[1]));
-    float real_angle = angle * PI_DEGREES / M_PI;
-    Render::device.PushMatrix();
-    Render::device.MatrixTranslate(mRect.mX - mDeltaX, mRect.mY + mDeltaY, 0);
-    Render::device.MatrixRotate(math::Vector3(0, 0, 1), real_angle);
-    mTexture->Draw();
-    Render::device.PopMatrix();
+    RKFunc(mKind, scratch.mPoint, wind_x, wind_y, scratch.mK[stage]);
 }
 
-void Rocket::Draw()
+void Rocket::FinishStep(float time_delta, const RocketStage& scratch)
 {
-    // Move the rocket on the current iteration
-    Move();
+    auto& k = scratch.mK;
+    for (int i = 0; i < N_DIM; i++)
+        mXYold[i] += time_delta * (k[0][i] + 2.0 * k[1][i] + 2.0 * k[2][i] + k[3][i]) / 6.0;
+
+    mRect.mX = mXYold[0];
+    mRect.mY = mXYold[2];
     CheckRocketOnUsed();
-    SimpleDraw();
 }
 
-void Rocket::DrawEffects(EffectsContainer& eff_cont)
+bool Rocket::IsValid(size_t handle_count) const
 {
-    if (!mFlyEffect)
-        mFlyEffect = eff_cont.AddEffect(FLY_ROCKET_EFFECT);
-    
-    if (mFlyEffect)
-    {
-        mFlyEffect->posX = mRect.mX;
-        mFlyEffect->posY = mRect.mY;
-
-        if (mIsUsed)
-            mFlyEffect->Finish();
-    }
+    // Levels are passed to the render thread in one byte
+    if (mKind >= ROCKET_KIND_COUNT || mLevel < 0 || mLevel > UINT8_MAX ||
+        mLevelLimit < -1 || mLevelLimit > UINT8_MAX || !IsHandle(mEffect, handle_count) ||
+        !IsHandle(mSaluteType, handle_count) || !std::isfinite(mDistance))
+        return false;
 
-    if (mFirstDraw)
+    for (int i = 0; i < N_DIM; i++)
     {
-        auto shot_effect = eff_cont.AddEffect(SHOT_EFFECT);
-        shot_effect->posX = mRect.mX;
-        shot_effect->posY = mRect.mY;
-        shot_effect->Reset();
-        mFirstDraw = false;
+        if (!std::isfinite(mXYold[i]))
+            return false;
     }
-
-    if (!mIsUsed)
-        return;
-
-    if (!mSaluteEffect)
-        mSaluteEffect = eff_cont.AddEffect(mSaluteEffectName);
-    if (!mSaluteEffect)
-        return;
-
-    MM::manager.PlaySample("SaluteSound");
-    mSaluteEffect->posX = mRect.mX;
-    mSaluteEffect->posY = mRect.mY;
-    mSaluteEffect->Reset();
-}
-
-//------------------------------------------------------------------------------------
-// RedRocket
-
-RedRocket::RedRocket(const RocketParams& params)
-    : Rocket(params)
-{
-    InitRocketParams();
+    return true;
 }
 
-void RedRocket::InitRocketParams()
+RocketState Rocket::State() const
 {
-    mTexture = utils::GetTexture(ROCKET_TEXTURE);
-    utils::InitSize(mTexture, mDeltaX, mDeltaY);
-
-    // Convert to rad/s
-    float w = ROCKET_RPM * M_PI / 30.00;
-    // Drag coefficient
-    float CD = 0.30 + 2.58e-4 * w;
-    mCm = 0.5 * CD * ROCKET_S * RHO / ROCKET_MASS;
-
-    // Swift factor
-    float CL = 0.3187 * (1.0 - exp(-2.483e-3 * w));
-    mKm = 0.5 * CL * ROCKET_S * RHO / ROCKET_MASS;
+    // Angle between the velocity and the vertical. The acos of vy / |v| is NaN for the vertical flight,
+    // when the ratio is rounded above one.
+    auto angle = atan2(fabs(mXYold[1]), mXYold[3]);
+    float real_angle = angle * PI_DEGREES / M_PI;
+    return { mId, static_cast<float>(mRect.mX), static_cast<float>(mRect.mY), real_angle,
+             static_cast<uint8_t>(mLevel), mKind, mMainRocket };
 }
 
 //------------------------------------------------------------------------------------
 // SaluteGun
-SaluteGun::SaluteGun()
-    : mIsPaused(false)
+SaluteGun::SaluteGun(unsigned seed)
+    : mIsPaused(false),
+    mAutoShot(true),
+    mAimMode(false),
+    mLevelLimit(0),
+    mFanOut(FAN_OUT),
+    mCapacity(ROCKET_CAPACITY),
+    mNextId(1),
+    mIdStep(1),
+    mSeed(seed),
+    mWind(nullptr),
+    mEffect(res::NO_HANDLE)
 {
-    mTexture = utils::GetTexture(GUN_TEXTURE);
-    IRect gun_rect = mTexture->getBitmapRect();
-    mRect.mWidth = gun_rect.width;
-    mRect.mHeight = gun_rect.height;
-
     mWinWidth = Config::WinWidth();
-    mRect.mX = mWinWidth / 2 - mRect.mWidth / 2;
-
     InitRockets(false);
     InitMinMaxPos(0, mWinWidth);
-    mShotTimer.Resume();
-    mHandShotTimer.Resume();
 }
 
-void SaluteGun::Draw()
+void SaluteGun::AddRocket(const RocketParams& params)
 {
-    Render::device.PushMatrix();
-    Render::device.MatrixTranslate(mRect.mX, 0, 0);
+    static auto& spawned_counter = metrics::Registry::Instance().GetCounter("rockets.spawned");
+    spawned_counter.Add();
 
-    IRect gun_rect = mTexture->getBitmapRect();
-    FRect rect(gun_rect);
-    FRect uv(0, 1, 0, 1);
-    mTexture->TranslateUV(rect, uv);
-    mTexture->Bind();
-    Render::DrawQuad(rect, uv);
-    Render::device.PopMatrix();
+    mRocketPool.emplace_back(params, mNextId, mSeed);
+    mNextId += mIdStep;
 }
 
 void SaluteGun::InitRockets(bool restart)
 {
-    mWeaponTimer.Resume();
-
     if (restart)
-    {
-        std::for_each(mRocketPool.begin(), mRocketPool.end(), [](RocketPtr& rocket_obj)
-        {
-            if (rocket_obj->mFlyEffect)
-                rocket_obj->mFlyEffect->Finish();
-        });
         mRocketPool.clear();
-    }
-    
-    mWeaponTimer.Start();
-    mPrevTime = 0.0f;
+}
+
+void SaluteGun::InitIds(uint32_t first, uint32_t step)
+{
+    mNextId = first;
+    mIdStep = step;
 }
 
 void SaluteGun::InitMinMaxPos(int min, int max)
@@ -351,127 +295,308 @@ void SaluteGun::InitMinMaxPos(int min, int max)
     mMaxX = max - mRect.mWidth;
 }
 
+void SaluteGun::InitSize(int width, int height)
+{
+    mRect.mWidth = width;
+    mRect.mHeight = height;
+    mRect.mX = mWinWidth / 2 - mRect.mWidth / 2;
+}
+
 void SaluteGun::Move(bool is_left)
 {
-    if (is_left)
-        mRect.mX -= GUN_VELOCITY;
-    else
-        mRect.mX += GUN_VELOCITY;
-    if (mRect.mX < mMinX)
-        mRect.mX = mMinX;
-    if (mRect.mX > mMaxX)
-        mRect.mX = mMaxX;
+    SetPosition(is_left ? mRect.mX - GUN_VELOCITY : mRect.mX + GUN_VELOCITY);
 }
 
 void SaluteGun::OnPausedMoving(bool pause)
 {
     mIsPaused = pause;
+}
+
+void SaluteGun::Publish(WorldSnapshot& snapshot) const
+{
+    snapshot.mGunX.push_back(mRect.mX);
     for (auto& rocket : mRocketPool)
-        rocket->mIsPaused = pause;
+        snapshot.mRockets.push_back(rocket.State());
 }
 
-void SaluteGun::RocketsDraw(EffectsContainer& eff_cont, const std::string& limit_str)
+void SaluteGun::Update(float dt)
 {
-    auto curr_time = mWeaponTimer.getElapsedTime();
-    TIME_DELTA = (curr_time - mPrevTime) * 10;
-    mPrevTime = curr_time;
+    PROFILE_ZONE("SaluteGun::Update");
+    static auto& spawned_counter = metrics::Registry::Instance().GetCounter("rockets.spawned");
+    static auto& retired_counter = metrics::Registry::Instance().GetCounter("rockets.retired");
+    static auto& dropped_counter = metrics::Registry::Instance().GetCounter("rockets.dropped");
 
-    // TODO To acceleration it is necessary to draw salutes in different threads.
-    // But there was a problem with the effects container. 
-    /*using Future = std::future<void>;
-    std::vector<Future> task_list;
-    size_t idx = 0;
+    if (mAutoShot)
+        Shot();
+    if (mIsPaused)
+        return;
 
-    auto rocket_draw_func = [](const RocketPtr& rocket, EffectsContainer& eff_cont)
+    // Containers keep their capacity between steps,
+    // so the steady show does not allocate memory.
+    float time_delta = dt * 10;
+    StepRockets(time_delta);
+
+    // Used rockets burst and emit the numbers of their sub-rockets,
+    // the prefix sum gives the slots of the sub-rockets after the pool.
+    // The pool never grows above the capacity: the last parents get fewer sub-rockets.
+    size_t count = mRocketPool.size();
+    size_t budget = mCapacity > count ? mCapacity - count : 0;
+    mSpawnOffsets.resize(count + 1);
+    size_t spawned = 0;
+    size_t dropped = 0;
+    for (size_t i = 0; i < count; i++)
     {
-        rocket->Draw();
-        rocket->DrawEffects(eff_cont);
-    };
+        mSpawnOffsets[i] = spawned;
+        const auto& rocket = mRocketPool[i];
+        if (!rocket.IsUsed())
+            continue;
+
+        mEvents.push_back({ WorldEvent::BURST, static_cast<float>(rocket.mRect.mX),
+                            static_cast<float>(rocket.mRect.mY), rocket.mEffect });
+        size_t sub_rockets = rocket.SubRocketCount(mLevelLimit, mFanOut);
+        size_t allowed = std::min(sub_rockets, budget - spawned);
+        spawned += allowed;
+        dropped += sub_rockets - allowed;
+    }
+    mSpawnOffsets[count] = spawned;
 
-    for (auto& rocket : mRocketPool)
+    // Every parent writes only its own slots, and its random numbers depend only on its id,
+    // so the parents can be processed in any order with the same result
+    mRocketPool.resize(count + spawned);
+    Rocket* children = mRocketPool.data() + count;
+    for (size_t i = 0; i < count; i++)
     {
-        //rocket_draw_func(rocket, eff_cont);
-        if (idx == mRocketPool.size() - 1)
-            rocket_draw_func(rocket, eff_cont);
-        else
-        {
-            auto task = std::async(rocket_draw_func, std::ref(rocket), std::ref(eff_cont));
-            task_list.push_back(std::move(task));
-        }
-
-        idx++;
+        size_t offset = mSpawnOffsets[i];
+        if (mSpawnOffsets[i + 1] != offset)
+            mRocketPool[i].CreateSubRockets(mEffect, mSeed, mNextId + static_cast<uint32_t>(offset) * mIdStep,
+                                            mIdStep, mFanOut, static_cast<int>(mSpawnOffsets[i + 1] - offset),
+                                            children + offset);
     }
+    mNextId += static_cast<uint32_t>(spawned) * mIdStep;
 
-    std::for_each(task_list.begin(), task_list.end(), [](Future& task) {
-        task.get();
-    });*/
+    // Stable compaction: flying rockets keep their order, the sub-rockets follow them
+    size_t alive = 0;
+    for (size_t i = 0; i < mRocketPool.size(); i++)
+    {
+        if (mRocketPool[i].IsUsed())
+            continue;
+        if (alive != i)
+            mRocketPool[alive] = mRocketPool[i];
+        ++alive;
+    }
+    retired_counter.Add(count + spawned - alive);
+    spawned_counter.Add(spawned);
+    dropped_counter.Add(dropped);
+    mRocketPool.resize(alive);
+}
 
-    int limit = utils::lexical_cast<int>(limit_str);
-    std::list<RocketPtr> tmp_rocket_pool;
+void SaluteGun::SetWind(const WindField* wind)
+{
+    mWind = wind;
+}
+
+void SaluteGun::SetClock(const utils::Clock* clock)
+{
+    mShotTimer.SetClock(clock);
+    mHandShotTimer.SetClock(clock);
+}
+
+void SaluteGun::StepRockets(float time_delta)
+{
+    // Rockets on the ground are used without moving
+    size_t count = mRocketPool.size();
     for (auto& rocket : mRocketPool)
+        rocket.BeginStep();
+
+    mStages.resize(count);
+    mStageX.resize(count);
+    mStageY.resize(count);
+    mWindX.assign(count, 0.0f);
+    mWindY.assign(count, 0.0f);
+    for (int stage = 0; stage < Rocket::RK_STAGES; stage++)
     {
-        rocket->Draw();
-        rocket->DrawEffects(eff_cont);
+        for (size_t i = 0; i < count; i++)
+            if (!mRocketPool[i].IsUsed())
+                mRocketPool[i].PrepareStage(stage, time_delta, mStages[i], mStageX[i], mStageY[i]);
 
-        auto new_rockets = rocket->CreateSubRockets(mSaluteEffectName, limit);
-        for (auto& params : new_rockets)
-            tmp_rocket_pool.push_back(std::make_unique<RedRocket>(params));
+        if (mWind)
+            mWind->SampleBatch(mStageX.data(), mStageY.data(), mWindX.data(), mWindY.data(), count);
+
+        for (size_t i = 0; i < count; i++)
+            if (!mRocketPool[i].IsUsed())
+                mRocketPool[i].CalcStage(stage, mWindX[i], mWindY[i], mStages[i]);
     }
 
-    auto delete_func = [](RocketPtr& b_object) -> bool
-    {
-        return b_object->Clear();
-    };
+    for (size_t i = 0; i < count; i++)
+        if (!mRocketPool[i].IsUsed())
+            mRocketPool[i].FinishStep(time_delta, mStages[i]);
+}
 
-    mRocketPool.remove_if(delete_func);
+void SaluteGun::SetAimMode(bool enabled)
+{
+    mAimMode = enabled;
+}
 
-    if (!tmp_rocket_pool.empty())
-        mRocketPool.splice(mRocketPool.end(), tmp_rocket_pool);
+void SaluteGun::SetAutoShot(bool enabled)
+{
+    mAutoShot = enabled;
 }
 
 // Set an effect of the rockets
-void SaluteGun::SetEffect(const std::string& effect_name)
+void SaluteGun::SetEffect(res::Handle effect)
+{
+    mEffect = effect;
+}
+
+void SaluteGun::SetCapacity(size_t capacity)
+{
+    mCapacity = capacity;
+    mRocketPool.reserve(capacity);
+    mSpawnOffsets.reserve(capacity + 1);
+    mStages.reserve(capacity);
+    mStageX.reserve(capacity);
+    mStageY.reserve(capacity);
+    mWindX.reserve(capacity);
+    mWindY.reserve(capacity);
+    // Every live rocket bursts once at most, the shots and the unsent events fit the rest
+    mEvents.reserve(2 * capacity);
+}
+
+void SaluteGun::SetFanOut(int fan_out)
+{
+    mFanOut = std::max(1, std::min(fan_out, static_cast<int>(Rocket::MAX_FAN_OUT)));
+}
+
+void SaluteGun::SetLevelLimit(int limit)
+{
+    mLevelLimit = limit;
+}
+
+void SaluteGun::SetPosition(int x)
+{
+    mRect.mX = x;
+    if (mRect.mX < mMinX)
+        mRect.mX = mMinX;
+    if (mRect.mX > mMaxX)
+        mRect.mX = mMaxX;
+}
+
+void SaluteGun::Save(save::Writer& writer) const
 {
-    mSaluteEffectName = effect_name;
+    GunState state = { mRect, mMinX, mMaxX, mLevelLimit, mFanOut, mNextId, mIdStep, mSeed,
+                       mShotTimer.Elapsed(), mHandShotTimer.Elapsed(), mEffect, mIsPaused, mAutoShot, mAimMode };
+    writer.Pod(state);
+    writer.Array(mRocketPool.data(), mRocketPool.size());
+    writer.Array(mEvents.data(), mEvents.size());
+}
+
+bool SaluteGun::Decode(save::Reader& reader, size_t capacity, size_t handle_count, SavedGun& saved)
+{
+    auto& state = saved.mState;
+    if (!reader.Pod(state) || !reader.Array(saved.mRockets, capacity) ||
+        !reader.Array(saved.mEvents, saved.mEvents.max_size()))
+        return false;
+
+    if (state.mMinX > state.mMaxX || state.mLevelLimit < 0 || state.mLevelLimit > UINT8_MAX ||
+        !state.mIdStep || !IsHandle(state.mEffect, handle_count) ||
+        !std::isfinite(state.mShotTime) || !std::isfinite(state.mHandShotTime))
+        return false;
+
+    for (auto& rocket : saved.mRockets)
+    {
+        if (!rocket.IsValid(handle_count))
+            return false;
+    }
+    for (auto& event : saved.mEvents)
+    {
+        if (event.mType > WorldEvent::SHOW_AUDIO || !IsHandle(event.mResource, handle_count))
+            return false;
+    }
+    return true;
+}
+
+void SaluteGun::Restore(const SavedGun& saved)
+{
+    auto& state = saved.mState;
+    mRect = state.mRect;
+    mMinX = state.mMinX;
+    mMaxX = state.mMaxX;
+    mLevelLimit = state.mLevelLimit;
+    SetFanOut(state.mFanOut);
+    mNextId = state.mNextId;
+    mIdStep = state.mIdStep;
+    mSeed = state.mSeed;
+    mEffect = state.mEffect;
+    mIsPaused = state.mIsPaused;
+    mAutoShot = state.mAutoShot;
+    mAimMode = state.mAimMode;
+    mShotTimer.SetElapsed(state.mShotTime);
+    mHandShotTimer.SetElapsed(state.mHandShotTime);
+    mRocketPool.assign(saved.mRockets.begin(), saved.mRockets.end());
+    mEvents.assign(saved.mEvents.begin(), saved.mEvents.end());
+}
+
+bool SaluteGun::Launch(float angle, res::Handle salute_type, int depth)
+{
+    if (mIsPaused || IsFull())
+        return false;
+
+    RocketParams main_params(mRect.mX + 2 * mRect.mWidth / 3,
+                             mRect.mHeight, angle, 0,
+                             salute_type, true);
+    main_params.mSaluteType = salute_type;
+    main_params.mLevelLimit = depth;
+    AddRocket(main_params);
+    mEvents.push_back({ WorldEvent::SHOT, static_cast<float>(main_params.mX),
+                        static_cast<float>(main_params.mY), res::SHOT_HANDLE });
+    return true;
 }
 
 bool SaluteGun::MouseShot(int x, int y)
 {
-    if (mIsPaused || mHandShotTimer.getElapsedTime() < HAND_SHOT_PERIOD)
+    if (mIsPaused || IsFull() || mHandShotTimer.Elapsed() < HAND_SHOT_PERIOD)
         return false;
 
-    mHandShotTimer.Resume();
-    MM::manager.PlaySample("ShotSound");
-    RocketParams main_params(x, y, PI_DEGREES / 2, 0, mSaluteEffectName);
-    RocketPtr rocket = std::make_unique<RedRocket>(main_params);
+    RocketParams main_params(x, y, PI_DEGREES / 2, 0, mEffect);
+    if (mAimMode)
+    {
+        // The main rocket from the muzzle with the solved angle and burst distance
+        main_params.mX = mRect.mX + 2 * mRect.mWidth / 3;
+        main_params.mY = mRect.mHeight;
+        main_params.mMainRocket = true;
+        if (!AimSolver::Instance(main_params.mKind).Solve(static_cast<float>(x - main_params.mX),
+                                                          static_cast<float>(y - main_params.mY),
+                                                          main_params.mRotateAngle, main_params.mDistance))
+            return false;
+    }
 
-    // Adjusting the initial position of the rocket
-    rocket->mFirstDraw = true;
-    mRocketPool.push_back(std::move(rocket));
+    AddRocket(main_params);
+    mEvents.push_back({ WorldEvent::SHOT, static_cast<float>(main_params.mX),
+                        static_cast<float>(main_params.mY), res::SHOT_HANDLE });
     mHandShotTimer.Start();
     return true;
 }
 
+void SaluteGun::ResetHandShot()
+{
+    mHandShotTimer.SetElapsed(HAND_SHOT_PERIOD);
+}
+
 bool SaluteGun::Shot(bool forced)
 {
-    if (mIsPaused)
+    if (mIsPaused || IsFull())
         return false;
 
-    if (forced && mHandShotTimer.getElapsedTime() < HAND_SHOT_PERIOD ||
-        !forced && mShotTimer.getElapsedTime() < SHOT_PERIOD)
+    if (forced && mHandShotTimer.Elapsed() < HAND_SHOT_PERIOD ||
+        !forced && mShotTimer.Elapsed() < SHOT_PERIOD)
         return false;
 
-    MM::manager.PlaySample("ShotSound");
-    mHandShotTimer.Resume();
-    mShotTimer.Resume();
     RocketParams main_params(mRect.mX + 2 * mRect.mWidth / 3, 
                              mRect.mHeight, PI_DEGREES / 2, 0, 
-                             mSaluteEffectName, true);
-    RocketPtr rocket = std::make_unique<RedRocket>(main_params);
-
-    // Adjusting the initial position of the rocket
-    rocket->mFirstDraw = true;
-    mRocketPool.push_back(std::move(rocket));
+                             mEffect, true);
+    AddRocket(main_params);
+    mEvents.push_back({ WorldEvent::SHOT, static_cast<float>(main_params.mX),
+                        static_cast<float>(main_params.mY), res::SHOT_HANDLE });
     mHandShotTimer.Start();
     mShotTimer.Start();
     return true;
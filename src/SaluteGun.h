@@ -6,12 +6,15 @@
  * \author Maksimovskiy A.S.
  */
 
-#include <future>
-#include <list>
-#include <memory>
+#include <cstdint>
+#include <vector>
 
 #include "Params.h"
+#include "ResourceIds.h"
+#include "RocketKinds.h"
+#include "SaveState.h"
 #include "Utils.h"
+#include "WindField.h"
 
 
 namespace weapons
@@ -27,82 +30,174 @@ struct RocketParams
     float mRotateAngle;
     // Level in a reaction chain
     int mLevel;
-    // Name of the salute effect
-    std::string mSaluteEffectName;
+    // Salute effect
+    res::Handle mEffect;
     // Main rocket flag
     bool mMainRocket;
+    // Kind of the rocket
+    RocketKindId mKind;
+    // Salute type and chain depth of the show launch, which are kept by the sub-rockets.
+    // No type and negative depth mean the settings of the gun.
+    res::Handle mSaluteType = res::NO_HANDLE;
+    int mLevelLimit = -1;
+    // Burst distance, negative means the random distance
+    float mDistance = -1.0f;
+
+    RocketParams(int x, int y, float angle, int level,
+                 res::Handle effect,
+                 bool is_main = false,
+                 RocketKindId kind = RED_ROCKET);
+};
+
+//------------------------------------------------------------------------------------
+// State of the rocket, which is passed to the render thread
+struct RocketState
+{
+    // Unique id of the rocket
+    uint32_t mId;
+    // Position of the rocket
+    float mX;
+    float mY;
+    // Rotate angle in degrees
+    float mAngle;
+    // Level in a reaction chain
+    uint8_t mLevel;
+    // Kind of the rocket
+    RocketKindId mKind;
+    // Main rocket flag
+    bool mMainRocket;
+};
+
+// Event of the simulation, which must be shown by the render thread
+struct WorldEvent
+{
+    enum Type : uint8_t
+    {
+        // Rocket was shot
+        SHOT,
+        // Rocket exploded
+        BURST,
+        // Sample of the show must be started
+        SHOW_AUDIO
+    };
+
+    Type mType;
+    // Position of the event
+    float mX;
+    float mY;
+    // Salute effect of the burst or the sample of the show
+    res::Handle mResource;
+};
+
+// Read-only view of the world snapshot. It points into the snapshot of the simulation
+// or into the frame, which the widget copied from the shared memory of the simulation server.
+struct SnapshotView
+{
+    uint64_t mTick = 0;
+    utils::ArrayRange<int> mGunX;
+    utils::ArrayRange<RocketState> mRockets;
+};
 
-    RocketParams(int x, int y, float angle, int level, 
-                 const std::string& effect_name,
-                 bool is_main = false);
+// Snapshot of the world, which is published by the simulation thread
+struct WorldSnapshot
+{
+    // Number of the simulation step
+    uint64_t mTick = 0;
+    // Id of the last applied input event
+    uint32_t mLastInput = 0;
+    // Positions of the guns
+    std::vector<int> mGunX;
+    // All flying rockets
+    std::vector<RocketState> mRockets;
+
+    // View of the snapshot, it is valid until the snapshot is changed
+    SnapshotView View() const
+    {
+        return { mTick, { mGunX.data(), mGunX.data() + mGunX.size() },
+                 { mRockets.data(), mRockets.data() + mRockets.size() } };
+    }
 };
 
 //------------------------------------------------------------------------------------
 
-// Base structure to describe the rocket
+struct RocketStage;
+
+// Structure to describe the rocket.
+// Coefficients of the rocket are taken from the kind table, so there are no virtual calls.
 struct Rocket
 {
-    Rocket(const RocketParams& params);
-    virtual ~Rocket() = default;
-    
+    // Empty rocket for the slot, which is written later
+    Rocket() = default;
+
+    // Random numbers of the rocket depend only on the seed and the id
+    Rocket(const RocketParams& params, uint32_t id, uint64_t seed);
+
     // Calculation of the angle of rotation of the rocket and the initial coordinates
     void CalcAngles(float rotate_angle);
 
-    // Ending all effects, delete pointer to texture
-    bool Clear();
+    // Number of the sub-rockets of the used rocket: zero or the fan-out
+    int SubRocketCount(int level_limit, int fan_out) const;
 
-    // Create new rockets for continue salute
-    std::list<RocketParams> CreateSubRockets(const std::string& salute_type, int level_limit);
+    // Write the first count of the fan-out sub-rockets with ids first_id, first_id + id_step...
+    // into the children. Directions of the sub-rockets do not depend on the count.
+    void CreateSubRockets(res::Handle salute_type, uint64_t seed, uint32_t first_id, uint32_t id_step,
+                          int fan_out, int count, Rocket* children) const;
 
-    // Rocket drawing.
-    // Accepts a link to the object vector object.
-    void Draw();
+    // Check that the rocket was used
+    bool IsUsed() const { return mIsUsed; }
 
-    // Draw all effects
-    void DrawEffects(EffectsContainer& eff_cont);
-    
-    // Method for simple drawing of a rocket
-    void SimpleDraw();
+    // Check the restored rocket: the ranges of the kind and levels, the finite motion,
+    // the handles must be less than handle_count
+    bool IsValid(size_t handle_count) const;
 
-    // Flag denoting the moment of a rocket shot
-    bool mFirstDraw;
+    // Copy the rocket state for the render thread
+    RocketState State() const;
 
-    // Rocket fly effect
-    ParticleEffectPtr mFlyEffect;
+    // The rocket is moved by the Runge - Kutta method in stages, so the wind
+    // is sampled for all rockets of the stage at once:
+    // BeginStep, then PrepareStage and CalcStage for every stage, then FinishStep.
+    // Values of the stages are kept by the gun, the rocket keeps only its state.
 
-    // The flag is responsible for the paused in the rocket moving.
-    bool mIsPaused;
+    // Start the step. Returns false if the rocket has fallen to the ground.
+    bool BeginStep();
+
+    // Point of the stage, where the wind must be sampled
+    void PrepareStage(int stage, float time_delta, RocketStage& scratch, float& x, float& y) const;
+
+    // Calculate the stage with the wind in its point
+    void CalcStage(int stage, float wind_x, float wind_y, RocketStage& scratch) const;
+
+    // Move the rocket by all stages
+    void FinishStep(float time_delta, const RocketStage& scratch);
+
+    // Function to calculate the coefficients by the method of Runge - Kutta
+    static void RKFunc(RocketKindId kind, const float* xy_old, float wind_x, float wind_y, float* y);
+
+    // Number of the stages
+    static constexpr int RK_STAGES = 4;
+
+    // Max number of the sub-rockets of one burst
+    static constexpr int MAX_FAN_OUT = 8;
+
+    // Unique id of the rocket
+    uint32_t mId;
 
     // Flag the main rocket
     bool mMainRocket;
-    
-protected:
-    // Drag param
-    float mCm;
 
-    // Corrective params
-    float mDeltaX;
-    float mDeltaY;
-    
-    // Swift param
-    float mKm;
+    // Rocket position
+    utils::Rect mRect;
 
-    // Rocket texture
-    Render::Texture* mTexture;
+    // Salute effect
+    res::Handle mEffect;
 
 private:
     // Array to store data about the previous position of the rocket
     float mXYold[N_DIM];
-    
-    // Function to calculate the coefficients by the method of Runge - Kutta
-    float* RKFunc(float* xy_old);
-    
+
     // Check that the rocket must to explode
     void CheckRocketOnUsed();
 
-    // Rocket movement method
-    void Move();
-
     // Distance rocket fly
     float mDistance;
 
@@ -112,36 +207,65 @@ private:
     // Level of the rockets
     int mLevel;
 
-    // Rocket size
-    utils::Rect mRect;
+    // Kind of the rocket
+    RocketKindId mKind;
+
+    // Salute type and chain depth of the show launch
+    res::Handle mSaluteType;
+    int mLevelLimit;
+
+    // Rocket init position
     utils::Rect mInitRect;
+};
 
-    // Rocket salute effect
-    ParticleEffectPtr mSaluteEffect;
-    std::string mSaluteEffectName;
+// Values of the Runge - Kutta step of one rocket: point of the current stage and coefficients of the stages
+struct RocketStage
+{
+    float mPoint[N_DIM];
+    float mK[Rocket::RK_STAGES][N_DIM];
 };
 
 //------------------------------------------------------------------------------------
-// Kind of rockets for salute
-struct RedRocket : public Rocket
+// Saved values of the gun, the rockets and the events follow them
+struct GunState
 {
-    RedRocket(const RocketParams& params);
-    virtual ~RedRocket() = default;
+    utils::Rect mRect;
+    int mMinX;
+    int mMaxX;
+    int mLevelLimit;
+    int mFanOut;
+    uint32_t mNextId;
+    uint32_t mIdStep;
+    uint64_t mSeed;
+    // Elapsed time of the shot timers
+    float mShotTime;
+    float mHandShotTime;
+    res::Handle mEffect;
+    bool mIsPaused;
+    bool mAutoShot;
+    bool mAimMode;
+};
 
-private:
-    void InitRocketParams();
+// Decoded state of the gun. It is checked completely, before the gun takes it.
+struct SavedGun
+{
+    GunState mState;
+    std::vector<Rocket> mRockets;
+    std::vector<WorldEvent> mEvents;
 };
 
 //------------------------------------------------------------------------------------
-// Weapon description class
+// Weapon description class.
+// The gun only simulates the rockets, it is drawn by SaluteView.
+// Guns do not share any state, so different guns can be stepped in parallel.
 class SaluteGun
 {
 public:
-    SaluteGun();
+    explicit SaluteGun(unsigned seed);
     ~SaluteGun() = default;
-    
-    // Drawing weapons
-    void Draw();
+
+    // Events of the simulation, which were not sent yet
+    std::vector<WorldEvent>& Events() { return mEvents; }
 
     // Initialization of rockets in the store
     void InitMinMaxPos(int min, int max);
@@ -149,57 +273,150 @@ public:
     // Initialization of rockets in the store
     void InitRockets(bool restart = false);
 
+    // Check that the gun has the max number of the live rockets
+    bool IsFull() const { return mRocketPool.size() >= mCapacity; }
+
+    // Initialization of the gun size
+    void InitSize(int width, int height);
+
+    // Launch of the show: the main rocket with the angle, salute type and chain depth
+    bool Launch(float angle, res::Handle salute_type, int depth);
+
+    // Ids of the rockets: first, first + step, first + 2 * step...
+    void InitIds(uint32_t first, uint32_t step);
+
     // Move salute gun
     void Move(bool is_left = true);
 
-    // Salute shot when mouse click
+    // Salute shot when mouse click.
+    // In the aim mode the gun fires, so the rocket bursts in the clicked point.
     bool MouseShot(int x, int y);
 
     // Change the flag on paused
     void OnPausedMoving(bool pause = true);
-    
-    // Drawing all rockets fired
-    void RocketsDraw(EffectsContainer& eff_cont, const std::string& limit_str);
+
+    // Add the state of the gun and rockets into the snapshot
+    void Publish(WorldSnapshot& snapshot) const;
+
+    // Place the gun, the position is clamped by the min and max positions
+    void SetPosition(int x);
+
+    // Turn the aim mode of the mouse shot on or off
+    void SetAimMode(bool enabled);
+
+    // Turn the auto shot by the shot timer on or off
+    void SetAutoShot(bool enabled);
 
     // Set an effect of the rockets
-    void SetEffect(const std::string& effect_name);
-    
+    void SetEffect(res::Handle effect);
+
+    // Set the wind, which is sampled by the rockets. Null means calm.
+    void SetWind(const WindField* wind);
+
+    // Set the clock of the shot timers
+    void SetClock(const utils::Clock* clock);
+
+    // Set the level limit of the chain reaction
+    void SetLevelLimit(int limit);
+
+    // Level limit and effect of the gun, e.g. for the menu after the restore
+    int LevelLimit() const { return mLevelLimit; }
+    res::Handle Effect() const { return mEffect; }
+
+    // Set the max number of the live rockets. The memory of the rockets is reserved at once.
+    void SetCapacity(size_t capacity);
+
+    // Set the number of the sub-rockets of one burst, it is clamped by Rocket::MAX_FAN_OUT
+    void SetFanOut(int fan_out);
+
+    // Write the state of the gun: position, settings, shot timers, random seed, rockets and unsent events
+    void Save(save::Writer& writer) const;
+
+    // Read and check the saved state of the gun: the ranges of the settings, kinds, levels and handles.
+    // The handles must be less than handle_count. Returns false if the state is broken
+    // or has more rockets than the capacity.
+    static bool Decode(save::Reader& reader, size_t capacity, size_t handle_count, SavedGun& saved);
+
+    // Take the decoded state. The rockets fit the capacity, which was passed to Decode.
+    void Restore(const SavedGun& saved);
+
     // Gun shot method
     bool Shot(bool forced = false);
 
+    // Allow the next hand or mouse shot at once, e.g. for the shots of the scripted volley
+    void ResetHandShot();
+
+    // Simulation step: auto shot, rockets moving and chain reaction
+    void Update(float dt);
+
 private:
-    using RocketPtr = std::unique_ptr<Rocket>;
+    // Add new rocket into the store
+    void AddRocket(const RocketParams& params);
+
+    // Move all rockets by the Runge - Kutta stages with the batch sampling of the wind
+    void StepRockets(float time_delta);
+
+    // Events of the simulation
+    std::vector<WorldEvent> mEvents;
 
     // Timer for delay shot by mouse and space click
-    Core::Timer mHandShotTimer;
+    utils::ClockTimer mHandShotTimer;
 
     // The flag is responsible for the paused in the rocket moving.
     bool mIsPaused;
 
+    // The flag of the auto shot by the shot timer
+    bool mAutoShot;
+
+    // The flag of the mouse shot from the gun into the clicked point
+    bool mAimMode;
+
+    // Level limit of the chain reaction
+    int mLevelLimit;
+
+    // Sub-rockets of one burst
+    int mFanOut;
+
+    // Max number of the live rockets
+    size_t mCapacity;
+
     // Min and max X position for gun
     int mMinX;
     int mMaxX;
 
-    // Previous time to calculate rocket flight
-    float mPrevTime;
+    // Id for the next rocket and the step between ids
+    uint32_t mNextId;
+    uint32_t mIdStep;
+
+    // Seed of the random numbers of the rockets
+    uint64_t mSeed;
 
     // Gun size and position
     utils::Rect mRect;
 
     // Rockets array.
-    std::list<RocketPtr> mRocketPool;
+    std::vector<Rocket> mRocketPool;
 
-    // Rocket salute effect name
-    std::string mSaluteEffectName;
+    // Slots of the sub-rockets of every rocket on the current step (prefix sums of their numbers)
+    std::vector<size_t> mSpawnOffsets;
 
-    // Shot timer
-    Core::Timer mShotTimer;
+    // Wind of the rockets
+    const WindField* mWind;
+
+    // Values of the Runge - Kutta stages of all rockets, they are not a part of the saved state
+    std::vector<RocketStage> mStages;
 
-    // Gun texture
-    Render::Texture* mTexture;
+    // Points of the stage and the wind in them for all rockets
+    std::vector<float> mStageX;
+    std::vector<float> mStageY;
+    std::vector<float> mWindX;
+    std::vector<float> mWindY;
 
-    // Timer for calculating the flight time of the rocket
-    Core::Timer mWeaponTimer;
+    // Rocket salute effect
+    res::Handle mEffect;
+
+    // Shot timer
+    utils::ClockTimer mShotTimer;
 
     // Width of the main window
     int mWinWidth;
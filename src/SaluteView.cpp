@@ -0,0 +1,297 @@
+/**
+ * \file
+ * \brief Implementation of the drawing of the salute gun, rockets and their effects
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "SaluteView.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Metrics.h"
+#include "Profiler.h"
+
+
+namespace weapons
+{
+
+namespace
+{
+
+// Read number of particles of every effect from the effects description.
+// Effects are registered, the numbers are indexed by their handles.
+void ReadEffectParticles(std::vector<int>& particles)
+{
+    std::vector<uint8_t> data;
+    if (!utils::ReadGameFile("SaluteEffects.xml", data))
+        return;
+
+    static const std::string EFFECT_TAG = "<Effect name=\"";
+    static const std::string PARTICLES_ATTR = "numOfParticles=\"";
+    std::string text(data.begin(), data.end());
+    size_t pos = text.find(EFFECT_TAG);
+    while (pos != std::string::npos)
+    {
+        size_t name_pos = pos + EFFECT_TAG.size();
+        std::string name = text.substr(name_pos, text.find('"', name_pos) - name_pos);
+        size_t next = text.find(EFFECT_TAG, name_pos);
+        res::Handle handle = res::Registry::Instance().Register(name);
+        if (handle == res::NO_HANDLE)
+        {
+            pos = next;
+            continue;
+        }
+
+        if (particles.size() <= handle)
+            particles.resize(handle + 1, 0);
+        int& count = particles[handle];
+        for (size_t attr = text.find(PARTICLES_ATTR, name_pos); attr < next; attr = text.find(PARTICLES_ATTR, attr + 1))
+            count += atoi(text.c_str() + attr + PARTICLES_ATTR.size());
+        pos = next;
+    }
+}
+
+}
+
+SaluteView::SaluteView()
+    : mTrailMode(false)
+{
+    auto& registry = res::Registry::Instance();
+    mGunTexture = registry.Texture(res::GUN_TEXTURE_HANDLE);
+    IRect gun_rect = mGunTexture->getBitmapRect();
+    mGunRect.mWidth = gun_rect.width;
+    mGunRect.mHeight = gun_rect.height;
+
+    for (int kind = 0; kind < ROCKET_KIND_COUNT; kind++)
+    {
+        auto& sprite = mKindSprites[kind];
+        sprite.mTexture = registry.Texture(registry.Register(ROCKET_KINDS[kind].mTexture));
+        utils::InitSize(sprite.mTexture, sprite.mDeltaX, sprite.mDeltaY);
+    }
+
+    ReadEffectParticles(mEffectParticles);
+    mTrailVertices.reserve(TRAIL_CAPACITY * (2 * TRAIL_LENGTH + 2));
+    mLiveEffects.reserve(EFFECT_CAPACITY);
+}
+
+ParticleEffectPtr SaluteView::AddEffect(res::Handle handle, EffectsContainer& eff_cont)
+{
+    static auto& effects_counter = metrics::Registry::Instance().GetCounter("effects.added");
+    static auto& dropped_counter = metrics::Registry::Instance().GetCounter("effects.dropped");
+    auto& registry = res::Registry::Instance();
+    if (handle >= registry.Count())
+        return nullptr;
+
+    // Deep chain reactions have more rockets than the effects, which can be shown
+    if (mLiveEffects.size() >= EFFECT_CAPACITY)
+    {
+        dropped_counter.Add();
+        return nullptr;
+    }
+
+    auto effect = eff_cont.AddEffect(registry.Name(handle));
+    if (effect)
+    {
+        int particles = handle < mEffectParticles.size() ? mEffectParticles[handle] : 0;
+        mLiveEffects.emplace_back(effect, particles);
+        effects_counter.Add();
+    }
+    return effect;
+}
+
+void SaluteView::ApplyEvent(const WorldEvent& event, uint64_t tick, EffectsContainer& eff_cont)
+{
+    switch (event.mType)
+    {
+    case WorldEvent::SHOT:
+    {
+        PlaySample(res::SHOT_SOUND_HANDLE);
+        auto shot_effect = AddEffect(res::SHOT_HANDLE, eff_cont);
+        if (!shot_effect)
+            break;
+
+        shot_effect->posX = event.mX;
+        shot_effect->posY = event.mY;
+        shot_effect->Reset();
+        break;
+    }
+    case WorldEvent::BURST:
+    {
+        // Merged burst is shown by the emitters of its cluster
+        if (!mBurstClusters.Add(event.mX, event.mY, event.mResource, tick))
+        {
+            static auto& merged_counter = metrics::Registry::Instance().GetCounter("bursts.merged");
+            static auto& saved_counter = metrics::Registry::Instance().GetCounter("particles.saved");
+            int particles = event.mResource < mEffectParticles.size() ? mEffectParticles[event.mResource] : 0;
+            merged_counter.Add();
+            saved_counter.Add(particles);
+            mStats.mSavedParticles += particles;
+            mStats.mMergedBursts = mBurstClusters.Merged();
+            break;
+        }
+
+        auto salute_effect = AddEffect(event.mResource, eff_cont);
+        if (!salute_effect)
+            break;
+
+        PlaySample(res::SALUTE_SOUND_HANDLE);
+        salute_effect->posX = event.mX;
+        salute_effect->posY = event.mY;
+        salute_effect->Reset();
+        break;
+    }
+    case WorldEvent::SHOW_AUDIO:
+        PlaySample(event.mResource);
+        break;
+    }
+}
+
+void SaluteView::Draw(const SnapshotView& snapshot, EffectsContainer& eff_cont)
+{
+    PROFILE_ZONE("SaluteView::Draw");
+    for (int gun_x : snapshot.mGunX)
+        DrawGun(gun_x);
+    if (mTrailMode)
+        DrawTrails(snapshot);
+    mStats.mLevelRockets.fill(0);
+    for (auto& rocket : snapshot.mRockets)
+    {
+        DrawRocket(rocket);
+        ++mStats.mLevelRockets[std::min<int>(rocket.mLevel, components::HUD_LEVELS - 1)];
+    }
+
+    UpdateFlyEffects(snapshot, eff_cont);
+    mBurstClusters.Expire(snapshot.mTick);
+    UpdateStats();
+}
+
+void SaluteView::DrawGun(int x)
+{
+    Render::device.PushMatrix();
+    Render::device.MatrixTranslate(x, 0, 0);
+
+    IRect gun_rect = mGunTexture->getBitmapRect();
+    FRect rect(gun_rect);
+    FRect uv(0, 1, 0, 1);
+    mGunTexture->TranslateUV(rect, uv);
+    mGunTexture->Bind();
+    Render::DrawQuad(rect, uv);
+    Render::device.PopMatrix();
+}
+
+void SaluteView::DrawRocket(const RocketState& rocket)
+{
+    if (!rocket.mMainRocket)
+        return;
+
+    auto& sprite = mKindSprites[rocket.mKind];
+    Render::device.PushMatrix();
+    Render::device.MatrixTranslate(rocket.mX - sprite.mDeltaX, rocket.mY + sprite.mDeltaY, 0);
+    Render::device.MatrixRotate(math::Vector3(0, 0, 1), rocket.mAngle);
+    sprite.mTexture->Draw();
+    Render::device.PopMatrix();
+}
+
+void SaluteView::DrawTrails(const SnapshotView& snapshot)
+{
+    PROFILE_ZONE("SaluteView::DrawTrails");
+    mTrails.Update(snapshot);
+    auto& strip = mTrails.BuildStrip();
+    if (strip.size() < 4)
+        return;
+
+    mTrailVertices.resize(strip.size());
+    for (size_t i = 0; i < strip.size(); i++)
+        mTrailVertices[i] = { strip[i].mX, strip[i].mY, 0.0f, strip[i].mColor, 0.0f, 0.0f };
+
+    Render::device.SetTexturing(false);
+    Render::device.SetBlendMode(Render::ADD);
+    Render::device.DrawStrip(mTrailVertices.data(), static_cast<int>(mTrailVertices.size()));
+    Render::device.SetBlendMode(Render::ALPHA);
+    Render::device.SetTexturing(true);
+}
+
+void SaluteView::PlaySample(res::Handle sample)
+{
+    static auto& samples_counter = metrics::Registry::Instance().GetCounter("audio.samples");
+    auto& registry = res::Registry::Instance();
+    if (sample >= registry.Count())
+        return;
+
+    samples_counter.Add();
+    int sample_id = MM::manager.PlaySample(registry.Name(sample));
+    if (sample_id > 0)
+        mLiveSamples.push_back(sample_id);
+}
+
+void SaluteView::UpdateStats()
+{
+    auto effect_end = std::remove_if(mLiveEffects.begin(), mLiveEffects.end(),
+                                     [](const std::pair<ParticleEffectPtr, int>& effect)
+    {
+        return effect.first->isEnd();
+    });
+    mLiveEffects.erase(effect_end, mLiveEffects.end());
+
+    auto sample_end = std::remove_if(mLiveSamples.begin(), mLiveSamples.end(), [](int sample_id)
+    {
+        return !MM::manager.IsPlaying(sample_id);
+    });
+    mLiveSamples.erase(sample_end, mLiveSamples.end());
+
+    mStats.mEffects = static_cast<int>(mLiveEffects.size());
+    mStats.mParticles = 0;
+    for (auto& effect : mLiveEffects)
+        mStats.mParticles += effect.second;
+    mStats.mVoices = static_cast<int>(mLiveSamples.size());
+}
+
+void SaluteView::ToggleTrails()
+{
+    mTrailMode = !mTrailMode;
+    mTrails.Clear();
+}
+
+void SaluteView::UpdateFlyEffects(const SnapshotView& snapshot, EffectsContainer& eff_cont)
+{
+    // In the trail mode rockets have no fly effects, so all of them are finished below
+    for (auto& rocket : snapshot.mRockets)
+    {
+        if (mTrailMode)
+            break;
+
+        // The effect is added once, so the refused effect is counted once
+        // and does not appear in the middle of the flight
+        auto& fly = mFlyEffects[rocket.mId];
+        if (!fly.mEffect && !fly.mDropped)
+        {
+            fly.mEffect = AddEffect(res::FLY_ROCKET_HANDLE, eff_cont);
+            fly.mDropped = !fly.mEffect;
+        }
+        fly.mTick = snapshot.mTick;
+        if (!fly.mEffect)
+            continue;
+
+        fly.mEffect->posX = rocket.mX;
+        fly.mEffect->posY = rocket.mY;
+    }
+
+    // Rockets, which are not in the snapshot, were used
+    for (auto it = mFlyEffects.begin(); it != mFlyEffects.end();)
+    {
+        if (it->second.mTick == snapshot.mTick && !mTrailMode)
+        {
+            ++it;
+            continue;
+        }
+
+        if (it->second.mEffect)
+            it->second.mEffect->Finish();
+        it = mFlyEffects.erase(it);
+    }
+}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Drawing of the salute gun, rockets and their effects
+ * \author Maksimovskiy A.S.
+ */
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "BurstClusters.h"
+#include "PerfHud.h"
+#include "SaluteGun.h"
+#include "TrailPool.h"
+
+
+namespace weapons
+{
+
+// Class draws the world snapshots, which are published by the simulation.
+class SaluteView
+{
+public:
+    SaluteView();
+    ~SaluteView() = default;
+
+    // Show the simulation event, which was received with the snapshot of the tick
+    void ApplyEvent(const WorldEvent& event, uint64_t tick, EffectsContainer& eff_cont);
+
+    // Drawing the gun and rockets of the snapshot
+    void Draw(const SnapshotView& snapshot, EffectsContainer& eff_cont);
+
+    // Gun size
+    int GunHeight() const { return mGunRect.mHeight; }
+    int GunWidth() const { return mGunRect.mWidth; }
+
+    // Counters of the last drawn snapshot
+    const components::ViewStats& Stats() const { return mStats; }
+
+    // Switch between the fly effects and the trails of the rockets
+    void ToggleTrails();
+
+private:
+    // Fly effect of the rocket
+    struct FlyEffect
+    {
+        ParticleEffectPtr mEffect;
+        // Last snapshot with this rocket
+        uint64_t mTick = 0;
+        // The effect was refused at EFFECT_CAPACITY, the rocket flies without it
+        bool mDropped = false;
+    };
+
+    // Add the effect and remember it for the counters. Returns null above EFFECT_CAPACITY.
+    ParticleEffectPtr AddEffect(res::Handle handle, EffectsContainer& eff_cont);
+
+    // Drawing the gun
+    void DrawGun(int x);
+
+    // Play the sample and remember it for the counters
+    void PlaySample(res::Handle sample);
+
+    // Update counters of the effects and sounds
+    void UpdateStats();
+
+    // Drawing the rocket
+    void DrawRocket(const RocketState& rocket);
+
+    // Drawing all trails by one strip
+    void DrawTrails(const SnapshotView& snapshot);
+
+    // Update fly effects: new rockets get the effect, effects of the lost rockets are finished
+    void UpdateFlyEffects(const SnapshotView& snapshot, EffectsContainer& eff_cont);
+
+    // Particles of the effects by effect handle
+    std::vector<int> mEffectParticles;
+
+    // Clusters of the bursts, which are shown by the common emitters
+    BurstClusters mBurstClusters;
+
+    // Fly effects by rocket id
+    std::unordered_map<uint32_t, FlyEffect> mFlyEffects;
+
+    // Trails of the rockets, which are drawn instead of the fly effects
+    TrailPool mTrails;
+    bool mTrailMode;
+
+    // Vertices of the trail strip for the render device
+    std::vector<Render::QuadVert> mTrailVertices;
+
+    // Gun size
+    utils::Rect mGunRect;
+
+    // Gun texture
+    Render::Texture* mGunTexture;
+
+    // Texture of the rocket kind with its corrective params
+    struct KindSprite
+    {
+        Render::Texture* mTexture = nullptr;
+        float mDeltaX = 0.0f;
+        float mDeltaY = 0.0f;
+    };
+
+    // Textures of the rocket kinds
+    std::array<KindSprite, ROCKET_KIND_COUNT> mKindSprites;
+
+    // Added effects with their particles, which are not ended yet
+    std::vector<std::pair<ParticleEffectPtr, int>> mLiveEffects;
+
+    // Played samples, which may be still playing
+    std::vector<int> mLiveSamples;
+
+    // Counters of the last drawn snapshot
+    components::ViewStats mStats;
+};
+
+}
@@ -3,14 +3,48 @@
 #include <windows.h>
 
 #include "Utils.h"
+#include "FramePacer.h"
+#include "InputLatency.h"
+#include "Metrics.h"
 #include "Params.h"
+#include "PerfHud.h"
+#include "Profiler.h"
 #include "SaluteWidget.h"
 
 
 using ObjectPtr = std::shared_ptr<components::Object>;
 
+namespace
+{
+
+// Send the wind of the city to the simulation. Missing wind means calm.
+void PostWind(weapons::Simulation& simulation, const std::string& city)
+{
+    weapons::Command command;
+    command.mType = weapons::Command::SET_WIND;
+    command.mWind = std::make_shared<weapons::WindField>();
+    if (!command.mWind->Load(city))
+        command.mWind.reset();
+    simulation.Post(command);
+}
+
+// Handle of the registered name
+res::Handle Resolve(const std::string& name)
+{
+    return res::Registry::Instance().Register(name);
+}
+
+}
+
 SaluteWidget::SaluteWidget(const std::string& name, rapidxml::xml_node<>* elem)
     : Widget(name),
+    mBackground(nullptr),
+    mAimMode(false),
+    mSharedTick(0),
+    mSharedInstance(0),
+    mSharedLatest(0),
+    mSharedLatestTime(0.0),
+    mAutosaveTime(0.0f),
     mMenu(Config::WinWidth() / 2, Config::WinHeight() / 2)
 {
     Init();
@@ -18,26 +52,49 @@ SaluteWidget::SaluteWidget(const std::string& name, rapidxml::xml_node<>* elem)
 
 void SaluteWidget::Init()
 {
+    PROFILE_THREAD("Render");
+
     // Init backgrounds type
     mBackGrounds.InitList(Config::Backgrounds());
+    mBackground = res::Registry::Instance().Texture(Resolve(mBackGrounds.Value().first));
     // Init difficulty level
     mSaluteDifficulty.InitList(Config::Difficulty());
     // Init salute types
     mSaluteTypes.InitList(Config::SaluteTypes());
-    mSaluteGun.SetEffect(mSaluteTypes.Value().first);
     // Init all buttons
     int x_pos = InitButtons();
-    mSaluteGun.InitMinMaxPos(x_pos, Config::WinWidth());
+    auto& battery = mSimulation.Battery();
+    battery.Init(BATTERY_SIZE, mSaluteView.GunWidth(), mSaluteView.GunHeight(), x_pos, Config::WinWidth(),
+                 static_cast<unsigned>(time(0)));
+    battery.SetEffect(Resolve(mSaluteTypes.Value().first));
+    battery.SetLevelLimit(utils::lexical_cast<int>(mSaluteDifficulty.Value().first));
     // Init menu with switchers
     InitMenu();
 
+    PostWind(mSimulation, mBackGrounds.Value().second);
+
     // Init action for mouse cursor
-    auto salute_gun_ptr = &mSaluteGun;
-    mCursor.InitAction([salute_gun_ptr](int x, int y)
+    mCursor.InitAction([this](int x, int y)
     {
-        salute_gun_ptr->MouseShot(x, y);
+        PostInput(weapons::Command::MOUSE_SHOT, x, y);
     });
 
+    // In the client mode the world is taken from the simulation server
+    if (Config::SharedWorld().empty())
+        mSimulation.Start();
+    else
+    {
+        mSharedEvents.reserve(shm::SHARED_MAX_EVENTS);
+        for (auto frame : { &mSharedFrame, &mSharedCopy })
+        {
+            frame->mGunX.reserve(shm::SHARED_MAX_GUNS);
+            frame->mRockets.reserve(ROCKET_CAPACITY);
+        }
+    }
+
+    if (Config::ResumeState())
+        RestoreState();
+
 #if defined(ENGINE_TARGET_WIN32)
     ShowCursor(FALSE);
 #endif
@@ -50,13 +107,13 @@ int SaluteWidget::InitButtons()
     // Pause button
     auto pause_button = components::PauseButton(BUTTON_DELTA_POS, BUTTON_DELTA_POS);
 
-    auto salute = &mSaluteGun;
+    auto salute = &mSimulation;
 
     // Play button
     auto play_button = components::PlayButton(BUTTON_DELTA_POS, BUTTON_DELTA_POS);
     play_button->InitAction([salute, play_button, pause_button]()
     {
-        salute->OnPausedMoving(false);
+        salute->Post(weapons::Command::RESUME);
         play_button->ChangeShow(false);
         pause_button->ChangeShow(true);
     });
@@ -65,7 +122,7 @@ int SaluteWidget::InitButtons()
     // Pause button
     pause_button->InitAction([salute, play_button, pause_button]()
     {
-        salute->OnPausedMoving(true);
+        salute->Post(weapons::Command::PAUSE);
         play_button->ChangeShow(true);
         pause_button->ChangeShow(false);
     });
@@ -75,7 +132,7 @@ int SaluteWidget::InitButtons()
     auto stop_button = components::StopButton(x_pos, BUTTON_DELTA_POS);
     stop_button->InitAction([salute]()
     {
-        salute->InitRockets(true);
+        salute->Post(weapons::Command::STOP);
     });
     x_pos += stop_button->mRect.mWidth + BUTTON_DELTA_POS;
 
@@ -99,16 +156,22 @@ void SaluteWidget::InitMenu()
     auto ground_ptr = &mBackGrounds;
     auto ground_right = components::RightButton(0, 0);
     auto ground_switcher = components::NewSwitcher(BACKGROUND_SWITCHER, ground_left, ground_right);
+    auto simulation_ptr = &mSimulation;
     ground_switcher->SetSettingName(mBackGrounds.Value().second);
-    ground_left->InitAction([ground_switcher, ground_ptr]()
+    auto background_ptr = &mBackground;
+    ground_left->InitAction([ground_switcher, ground_ptr, background_ptr, simulation_ptr]()
     {
         ground_ptr->Prev();
         ground_switcher->SetSettingName(ground_ptr->Value().second);
+        *background_ptr = res::Registry::Instance().Texture(Resolve(ground_ptr->Value().first));
+        PostWind(*simulation_ptr, ground_ptr->Value().second);
     });
-    ground_right->InitAction([ground_switcher, ground_ptr]()
+    ground_right->InitAction([ground_switcher, ground_ptr, background_ptr, simulation_ptr]()
     {
         ground_ptr->Next();
         ground_switcher->SetSettingName(ground_ptr->Value().second);
+        *background_ptr = res::Registry::Instance().Texture(Resolve(ground_ptr->Value().first));
+        PostWind(*simulation_ptr, ground_ptr->Value().second);
     });
 
     // Change difficulty of the salute
@@ -117,35 +180,42 @@ void SaluteWidget::InitMenu()
     auto mode_right = components::RightButton(0, 0);
     auto mode_switcher = components::NewSwitcher(DIFFICULTY_SWITCHER, mode_left, mode_right);
     mode_switcher->SetSettingName(mSaluteDifficulty.Value().second);
-    mode_left->InitAction([mode_switcher, mode_ptr]()
+    mode_left->InitAction([mode_switcher, mode_ptr, simulation_ptr]()
     {
         mode_ptr->Prev();
         mode_switcher->SetSettingName(mode_ptr->Value().second);
+        simulation_ptr->Post(weapons::Command::SET_LEVEL_LIMIT,
+                             utils::lexical_cast<int>(mode_ptr->Value().first));
     });
-    mode_right->InitAction([mode_switcher, mode_ptr]()
+    mode_right->InitAction([mode_switcher, mode_ptr, simulation_ptr]()
     {
         mode_ptr->Next();
         mode_switcher->SetSettingName(mode_ptr->Value().second);
+        simulation_ptr->Post(weapons::Command::SET_LEVEL_LIMIT,
+                             utils::lexical_cast<int>(mode_ptr->Value().first));
     });
     
     // Change type of the salute
     auto type_left = components::LeftButton(0, 0);
     auto type_right = components::RightButton(0, 0);
     auto type_ptr = &mSaluteTypes;
-    auto salute_gun_ptr = &mSaluteGun;
+    auto set_effect = [simulation_ptr](const std::string& effect_name)
+    {
+        simulation_ptr->Post(weapons::Command::SET_EFFECT, Resolve(effect_name));
+    };
     auto type_switcher = components::NewSwitcher(TYPE_SWITCHER, type_left, type_right);
     type_switcher->SetSettingName(mSaluteTypes.Value().second);
-    type_left->InitAction([type_switcher, type_ptr, salute_gun_ptr]()
+    type_left->InitAction([type_switcher, type_ptr, set_effect]()
     {
         type_ptr->Prev();
         type_switcher->SetSettingName(type_ptr->Value().second);
-        salute_gun_ptr->SetEffect(type_ptr->Value().first);
+        set_effect(type_ptr->Value().first);
     });
-    type_right->InitAction([type_switcher, type_ptr, salute_gun_ptr]()
+    type_right->InitAction([type_switcher, type_ptr, set_effect]()
     {
         type_ptr->Next();
         type_switcher->SetSettingName(type_ptr->Value().second);
-        salute_gun_ptr->SetEffect(type_ptr->Value().first);
+        set_effect(type_ptr->Value().first);
     });
 
     // Continue switcher
@@ -164,30 +234,176 @@ void SaluteWidget::InitMenu()
     });
 
     mMenu.AddSwitchers({ ground_switcher, mode_switcher, type_switcher, continue_switcher, exit_switcher });
+    mModeSwitcher = mode_switcher;
+    mTypeSwitcher = type_switcher;
 }
 
 void SaluteWidget::Draw()
 {
+    PROFILE_ZONE("SaluteWidget::Draw");
+
     // Background draw
-    utils::DrawTexture(mBackGrounds.Value().first);
+    utils::DrawTexture(mBackground);
     // Draw all buttons
     mButtonPool.DrawAll();
-    // Draw salute and rockets
-    mSaluteGun.Shot();
-    mSaluteGun.Draw();
-    mSaluteGun.RocketsDraw(mEffCont, mSaluteDifficulty.Value().first);
+    // Show events of the simulation and draw the latest snapshot
+    if (Config::SharedWorld().empty())
+    {
+        auto& snapshot = mSimulation.Snapshot();
+        weapons::WorldEvent event;
+        while (mSimulation.PopEvent(event))
+            mSaluteView.ApplyEvent(event, snapshot.mTick, mEffCont);
+        mSaluteView.Draw(snapshot.View(), mEffCont);
+        input::LatencyTracker::Instance().Reflect(snapshot.mLastInput);
+        // The file is written by the background thread, the state is dropped while the previous one is written
+        if (mSimulation.TakeState(mStateBuffer) &&
+            !mStateWriter.Write(Config::WriteDirectory() + "/" + SAVE_FILE, mStateBuffer))
+            Log::log.WriteWarn("The previous state is still written, the state is dropped");
+        weapons::RestoredSettings restored;
+        if (mSimulation.TakeRestored(restored))
+            ShowRestored(restored);
+    }
+    else
+        DrawShared();
+    components::PerfHud::Instance().SetViewStats(mSaluteView.Stats());
     // Draw all the effects that are added to the container
-    mEffCont.Draw();
+    {
+        PROFILE_ZONE("EffectsContainer::Draw");
+        mEffCont.Draw();
+    }
     // Draw menu with switchers
     mMenu.DrawAll();
     // Draw cursor over all objects
     mCursor.Draw();
 }
 
+void SaluteWidget::DrawShared()
+{
+    // The server may be started after the client
+    if (!mSharedWorld.IsOpen() && !mSharedWorld.Open(Config::SharedWorld()))
+        return;
+
+    static auto& torn_counter = metrics::Registry::Instance().GetCounter("shm.torn_frames");
+    uint64_t latest = mSharedWorld.LatestTick();
+    double now = utils::WallClock::Instance().Now();
+    if (latest != mSharedLatest)
+    {
+        mSharedLatest = latest;
+        mSharedLatestTime = now;
+    }
+    else if (now - mSharedLatestTime >= shm::SHARED_STALL_TIME)
+    {
+        // The restarted POSIX server writes into the new memory, so the stalled one is mapped again
+        mSharedLatestTime = now;
+        if (!mSharedWorld.Open(Config::SharedWorld()))
+            return;
+        latest = mSharedWorld.LatestTick();
+    }
+    // The server was restarted: the new memory or the Win32 mapping, which was created again
+    if (mSharedWorld.Instance() != mSharedInstance || latest < mSharedTick)
+    {
+        mSharedInstance = mSharedWorld.Instance();
+        mSharedTick = 0;
+    }
+    if (!latest)
+        return;
+
+    // Events of the ticks since the last frame, the older ticks are already rewritten
+    uint64_t first = std::max(mSharedTick + 1, latest >= shm::SHARED_SLOTS ? latest - shm::SHARED_SLOTS + 1 : 1);
+    shm::SharedFrame frame;
+    for (uint64_t tick = first; tick <= latest; tick++)
+    {
+        if (!mSharedWorld.Acquire(tick, frame))
+            continue;
+
+        mSharedEvents.assign(frame.mEvents.begin(), frame.mEvents.end());
+        if (!mSharedWorld.Validate(frame))
+        {
+            torn_counter.Add();
+            continue;
+        }
+        for (auto& event : mSharedEvents)
+            mSaluteView.ApplyEvent(event, tick, mEffCont);
+    }
+    mSharedTick = latest;
+
+    // The frame is copied and validated before the drawing, so the torn frame is never drawn.
+    // The last valid frame is drawn instead of it.
+    if (mSharedWorld.Acquire(latest, frame))
+    {
+        mSharedCopy.mTick = frame.mView.mTick;
+        mSharedCopy.mGunX.assign(frame.mView.mGunX.begin(), frame.mView.mGunX.end());
+        mSharedCopy.mRockets.assign(frame.mView.mRockets.begin(), frame.mView.mRockets.end());
+        if (mSharedWorld.Validate(frame))
+            std::swap(mSharedFrame, mSharedCopy);
+        else
+            torn_counter.Add();
+    }
+    mSaluteView.Draw(mSharedFrame.View(), mEffCont);
+}
+
+void SaluteWidget::PostInput(weapons::Command::Type type, int x, int y)
+{
+    weapons::Command command;
+    command.mType = type;
+    command.mX = x;
+    command.mY = y;
+    command.mInputId = input::LatencyTracker::Instance().Capture(command.mInputTime);
+    mSimulation.Post(command);
+}
+
+void SaluteWidget::RestoreState()
+{
+    if (!Config::SharedWorld().empty())
+        return;
+
+    auto state = std::make_shared<std::vector<uint8_t>>();
+    if (!save::ReadFile(Config::WriteDirectory() + "/" + SAVE_FILE, *state))
+    {
+        Log::log.WriteError("Can not read the saved state " + SAVE_FILE);
+        return;
+    }
+
+    weapons::Command command;
+    command.mType = weapons::Command::RESTORE_STATE;
+    command.mHandleCount = res::Registry::Instance().Count();
+    command.mState = std::move(state);
+    // The show is used only if it was played in the state
+    auto schedule = std::make_shared<show::ShowSchedule>();
+    if (schedule->Load(SHOW_FILE))
+        command.mShow = std::move(schedule);
+    mSimulation.Post(command);
+}
+
+void SaluteWidget::ShowRestored(const weapons::RestoredSettings& settings)
+{
+    auto is_level_limit = [&settings](const Config::SettingType& setting)
+    {
+        return utils::lexical_cast<int>(setting.first) == settings.mLevelLimit;
+    };
+    auto is_effect = [&settings](const Config::SettingType& setting)
+    {
+        return Resolve(setting.first) == settings.mEffect;
+    };
+    // Settings, which are not in the lists, are kept by the simulation, but are not shown
+    if (mSaluteDifficulty.Select(is_level_limit))
+        mModeSwitcher->SetSettingName(mSaluteDifficulty.Value().second);
+    if (mSaluteTypes.Select(is_effect))
+        mTypeSwitcher->SetSettingName(mSaluteTypes.Value().second);
+}
+
 void SaluteWidget::Update(float dt)
 {
-    mCursor.Draw();
+    PROFILE_ZONE("EffectsContainer::Update");
     mEffCont.Update(dt);
+
+    // Last state for the recovery after the crash
+    mAutosaveTime += dt;
+    if (mAutosaveTime >= AUTOSAVE_PERIOD && Config::SharedWorld().empty())
+    {
+        mAutosaveTime = 0.0f;
+        mSimulation.Post(weapons::Command::SAVE_STATE);
+    }
 }
 
 bool SaluteWidget::MouseDown(const IPoint& mouse_pos)
@@ -204,6 +420,8 @@ bool SaluteWidget::MouseDown(const IPoint& mouse_pos)
 
 void SaluteWidget::MouseMove(const IPoint& mouse_pos)
 {
+    mButtonPool.CheckMouseMove(mouse_pos.x, mouse_pos.y);
+    mMenu.CheckMouseMove(mouse_pos.x, mouse_pos.y);
 }
 
 void SaluteWidget::MouseUp(const IPoint &mouse_pos)
@@ -224,17 +442,56 @@ void SaluteWidget::KeyPressed(int keyCode)
     switch (keyCode)
     {
     case VK_LEFT:
-        mSaluteGun.Move();
+        PostInput(weapons::Command::MOVE_LEFT);
         break;
     case VK_RIGHT:
-        mSaluteGun.Move(false);
+        PostInput(weapons::Command::MOVE_RIGHT);
         break;
     case VK_SPACE:
-        mSaluteGun.Shot(true);
+        PostInput(weapons::Command::SHOT);
         break;
     case VK_ESCAPE:
         mMenu.Show(true);
         break;
+    case VK_F1:
+        components::PerfHud::Instance().Toggle();
+        break;
+    case VK_F2:
+        mSaluteView.ToggleTrails();
+        break;
+    case VK_F3:
+        mAimMode = !mAimMode;
+        mSimulation.Post(weapons::Command::SET_AIM_MODE, mAimMode ? 1 : 0);
+        break;
+    case VK_F4:
+        pacing::FramePacer::Instance().NextRate();
+        break;
+    case VK_F5:
+        mSimulation.Post(weapons::Command::SAVE_STATE);
+        break;
+    case VK_F6:
+        RestoreState();
+        break;
+    case VK_F7:
+    {
+        auto schedule = std::make_shared<show::ShowSchedule>();
+        if (!schedule->Load(SHOW_FILE))
+            break;
+
+        weapons::Command command;
+        command.mType = weapons::Command::PLAY_SHOW;
+        command.mShow = std::move(schedule);
+        mSimulation.Post(command);
+        break;
+    }
+    case VK_F8:
+        mSimulation.Post(weapons::Command::STOP_SHOW);
+        break;
+#if defined(SALUTE_PROFILING)
+    case VK_F9:
+        profiler::DumpTrace(Config::WriteDirectory() + "/trace.json", TRACE_DURATION);
+        break;
+#endif
     }
 }
 
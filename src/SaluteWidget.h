@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Components.h"
-#include "SaluteGun.h"
+#include "SaluteView.h"
+#include "SharedWorld.h"
+#include "Simulation.h"
 
 
 // Widget for drawing the battlefield.
@@ -29,9 +31,21 @@ private:
     int InitButtons();
     // Init menu panel
     void InitMenu();
+    // Show events and draw the latest frame of the simulation server
+    void DrawShared();
+    // Send the saved state from the file to the simulation
+    void RestoreState();
+    // Show the settings of the restored state by the menu switchers
+    void ShowRestored(const weapons::RestoredSettings& settings);
+    // Send the input event with its capture time to the simulation
+    void PostInput(weapons::Command::Type type, int x = 0, int y = 0);
 
     // Background
     utils::RecursiveList<Config::SettingType> mBackGrounds;
+    // Texture of the current background
+    Render::Texture* mBackground;
+    // Mouse shots burst in the clicked point
+    bool mAimMode;
     // All buttons
     components::ButtonPool mButtonPool;
     // Cursor
@@ -40,11 +54,34 @@ private:
     EffectsContainer mEffCont;
     // Menu with switchers
     components::Menu mMenu;
-    // Salute gun for shot rockets
-    weapons::SaluteGun mSaluteGun;
+    // Drawing of the salute gun and rockets
+    weapons::SaluteView mSaluteView;
+    // Simulation of the salute gun in its own thread
+    weapons::Simulation mSimulation;
+    // Frames of the simulation server in the client mode
+    shm::WorldReader mSharedWorld;
+    // Last tick of the server, which events were shown
+    uint64_t mSharedTick;
+    // Server of the mapped memory, its last tick and the wall time, when the tick was changed
+    uint64_t mSharedInstance;
+    uint64_t mSharedLatest;
+    double mSharedLatestTime;
+    // Events of the server frame, they are copied before the frame is validated
+    std::vector<weapons::WorldEvent> mSharedEvents;
+    // Last valid server frame, which is drawn, and the copy of the next frame before its validation
+    weapons::WorldSnapshot mSharedFrame;
+    weapons::WorldSnapshot mSharedCopy;
+    // State, which was saved by the simulation, and its writer into the file
+    std::vector<uint8_t> mStateBuffer;
+    save::FileWriter mStateWriter;
+    // Time since the last autosave
+    float mAutosaveTime;
     // Salute difficulty
     utils::RecursiveList<Config::SettingType> mSaluteDifficulty;
     // Salute types
     utils::RecursiveList<Config::SettingType> mSaluteTypes;
+    // Switchers of the difficulty and the salute type
+    components::SwitcherPtr mModeSwitcher;
+    components::SwitcherPtr mTypeSwitcher;
 
 };
@@ -0,0 +1,171 @@
+/**
+ * \file
+ * \brief Implementation of the binary snapshots of the salute world
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "SaveState.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+
+#if defined(ENGINE_TARGET_WIN32)
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace save
+{
+
+uint32_t Checksum(const uint8_t* data, size_t size)
+{
+    // Words are hashed instead of the bytes, so the checksum of the big battery is cheap
+    const uint64_t PRIME = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull;
+    size_t words = size / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++)
+    {
+        uint64_t word;
+        memcpy(&word, data + i * sizeof(word), sizeof(word));
+        hash = (hash ^ word) * PRIME;
+    }
+    for (size_t i = words * sizeof(uint64_t); i < size; i++)
+        hash = (hash ^ data[i]) * PRIME;
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+//------------------------------------------------------------------------------------
+// Writer
+
+Writer::Writer(std::vector<uint8_t>& buffer, uint32_t rocket_size)
+    : mBuffer(buffer)
+{
+    mBuffer.clear();
+    SaveHeader header = { SAVE_MAGIC, SAVE_VERSION, 0, rocket_size, 0 };
+    Pod(header);
+}
+
+void Writer::Bytes(const void* data, size_t size)
+{
+    if (!size)
+        return;
+
+    size_t pos = mBuffer.size();
+    mBuffer.resize(pos + size);
+    memcpy(mBuffer.data() + pos, data, size);
+}
+
+void Writer::Finish()
+{
+    uint64_t size = mBuffer.size() - sizeof(SaveHeader);
+    uint32_t checksum = Checksum(mBuffer.data() + sizeof(SaveHeader), static_cast<size_t>(size));
+    memcpy(mBuffer.data() + offsetof(SaveHeader, mSize), &size, sizeof(size));
+    memcpy(mBuffer.data() + offsetof(SaveHeader, mChecksum), &checksum, sizeof(checksum));
+}
+
+//------------------------------------------------------------------------------------
+// Reader
+
+Reader::Reader(const uint8_t* data, size_t size, uint32_t rocket_size)
+    : mData(data),
+    mSize(size),
+    mPos(0),
+    mValid(true)
+{
+    SaveHeader header;
+    mValid = Pod(header) && header.mMagic == SAVE_MAGIC && header.mVersion == SAVE_VERSION &&
+             header.mSize == mSize - mPos && header.mRocketSize == rocket_size &&
+             header.mChecksum == Checksum(mData + mPos, mSize - mPos);
+}
+
+bool Reader::Bytes(void* data, size_t size)
+{
+    if (!mValid || size > mSize - mPos)
+        return mValid = false;
+
+    memcpy(data, mData + mPos, size);
+    mPos += size;
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+
+bool WriteFile(const std::string& path, const std::vector<uint8_t>& state)
+{
+    std::string temp_path = path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file)
+    {
+        Log::log.WriteError("Can not create the state " + temp_path);
+        return false;
+    }
+
+    // The data must be on the disk before the rename, or the crash can leave the empty state
+    bool written = fwrite(state.data(), 1, state.size(), file) == state.size() && fflush(file) == 0;
+#if defined(ENGINE_TARGET_WIN32)
+    written = written && FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)))) != 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    written = fclose(file) == 0 && written;
+    if (!written)
+    {
+        Log::log.WriteError("Can not write the state " + temp_path);
+        return false;
+    }
+
+#if defined(ENGINE_TARGET_WIN32)
+    bool renamed = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool renamed = std::rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+    if (!renamed)
+        Log::log.WriteError("Can not replace the state " + path);
+    return renamed;
+}
+
+bool ReadFile(const std::string& path, std::vector<uint8_t>& state)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return false;
+
+    auto size = static_cast<size_t>(in.tellg());
+    state.resize(size);
+    in.seekg(0);
+    return size >= sizeof(SaveHeader) && in.read(reinterpret_cast<char*>(state.data()), size).good();
+}
+
+//------------------------------------------------------------------------------------
+// FileWriter
+
+FileWriter::~FileWriter()
+{
+    if (mThread.joinable())
+        mThread.join();
+}
+
+bool FileWriter::Write(const std::string& path, std::vector<uint8_t>& state)
+{
+    if (mWriting.exchange(true))
+        return false;
+    if (mThread.joinable())
+        mThread.join();
+
+    mPath = path;
+    mBuffer.swap(state);
+    mThread = std::thread([this]()
+    {
+        WriteFile(mPath, mBuffer);
+        mWriting.store(false);
+    });
+    return true;
+}
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Versioned binary snapshots of the salute world
+ * \author Maksimovskiy A.S.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace save
+{
+
+// Signature and format version of the saved state.
+// The version must be changed with any saved structure.
+constexpr uint32_t SAVE_MAGIC = 0x56415353; // "SSAV"
+constexpr uint32_t SAVE_VERSION = 5;
+
+// Beginning of the saved state, the sections of the simulation follow it
+struct SaveHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    // Size of the data after the header
+    uint64_t mSize;
+    // Size of the rocket, so the state of another build is not restored
+    uint32_t mRocketSize;
+    // Checksum of the data after the header
+    uint32_t mChecksum;
+};
+
+// Checksum of the saved data: FNV-1a of the 64-bit words, it is folded into 32 bits
+uint32_t Checksum(const uint8_t* data, size_t size);
+
+//------------------------------------------------------------------------------------
+// Writer of the state into the buffer. Pools are written by one memcpy,
+// the buffer keeps its capacity, so the steady saves do not allocate memory.
+class Writer
+{
+public:
+    Writer(std::vector<uint8_t>& buffer, uint32_t rocket_size);
+
+    // Write the value
+    template<typename T>
+    void Pod(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are saved");
+        Bytes(&value, sizeof(T));
+    }
+
+    // Write the number of the elements and the elements
+    template<typename T>
+    void Array(const T* data, size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable arrays are saved");
+        Pod(static_cast<uint64_t>(count));
+        Bytes(data, count * sizeof(T));
+    }
+
+    // Write the size and the checksum of the data into the header
+    void Finish();
+
+private:
+    void Bytes(const void* data, size_t size);
+
+    std::vector<uint8_t>& mBuffer;
+};
+
+//------------------------------------------------------------------------------------
+// Reader of the saved state. Any error is kept, so the sections are read without
+// the checks and the result is checked once by IsValid.
+class Reader
+{
+public:
+    // Check the header and the checksum of the state
+    Reader(const uint8_t* data, size_t size, uint32_t rocket_size);
+
+    // Check that the header and the checksum are right and nothing was read outside the data
+    bool IsValid() const { return mValid; }
+
+    // Check that all data were read
+    bool IsFinished() const { return mValid && mPos == mSize; }
+
+    // Read the value, it is not changed on error
+    template<typename T>
+    bool Pod(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are restored");
+        return Bytes(&value, sizeof(T));
+    }
+
+    // Read the array, which has no more than max_count elements
+    template<typename T>
+    bool Array(std::vector<T>& values, size_t max_count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable arrays are restored");
+        uint64_t count = 0;
+        if (!Pod(count) || count > max_count || count * sizeof(T) > mSize - mPos)
+            return mValid = false;
+
+        auto first = reinterpret_cast<const T*>(mData + mPos);
+        values.resize(static_cast<size_t>(count));
+        if (count)
+            memcpy(values.data(), first, static_cast<size_t>(count) * sizeof(T));
+        mPos += static_cast<size_t>(count) * sizeof(T);
+        return true;
+    }
+
+private:
+    bool Bytes(void* data, size_t size);
+
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mPos;
+    bool mValid;
+};
+
+//------------------------------------------------------------------------------------
+// Write the state into the file. It is written into the temporary file, flushed to the disk
+// and renamed, so the crash during the writing keeps the previous state.
+bool WriteFile(const std::string& path, const std::vector<uint8_t>& state);
+
+// Read the state from the file
+bool ReadFile(const std::string& path, std::vector<uint8_t>& state);
+
+//------------------------------------------------------------------------------------
+// Writer of the state files on its own thread, so the render thread does not wait for the disk
+class FileWriter
+{
+public:
+    FileWriter() = default;
+    ~FileWriter();
+
+    // Start writing the state into the file. The state is swapped with the buffer of the writer,
+    // so their capacities are reused. Returns false if the previous state is still written.
+    bool Write(const std::string& path, std::vector<uint8_t>& state);
+
+private:
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    std::thread mThread;
+    std::atomic<bool> mWriting{ false };
+    std::string mPath;
+    std::vector<uint8_t> mBuffer;
+};
+
+}
@@ -0,0 +1,315 @@
+/**
+ * \file
+ * \brief Implementation of the world snapshots in the shared memory
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "SharedWorld.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#if defined(ENGINE_TARGET_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace shm
+{
+
+namespace
+{
+
+// Offset of the first slot from the beginning of the memory
+constexpr size_t SLOTS_OFFSET = (sizeof(SharedHeader) + 63) / 64 * 64;
+
+// Name of the memory for the system
+std::string SystemName(const std::string& name)
+{
+#if defined(ENGINE_TARGET_WIN32)
+    return "Local\\" + name;
+#else
+    return "/" + name;
+#endif
+}
+
+uint32_t Hash(uint32_t hash, const void* data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+}
+
+uint32_t FrameChecksum(const SharedSlot& slot)
+{
+    uint32_t guns = std::min<uint32_t>(slot.mGunCount, SHARED_MAX_GUNS);
+    uint32_t events = std::min<uint32_t>(slot.mEventCount, SHARED_MAX_EVENTS);
+    uint32_t rockets = std::min<uint32_t>(slot.mRocketCount, ROCKET_CAPACITY);
+    uint32_t hash = Hash(2166136261u, &slot.mTick, sizeof(slot.mTick));
+    hash = Hash(hash, slot.mGunX, guns * sizeof(slot.mGunX[0]));
+    hash = Hash(hash, slot.mEvents, events * sizeof(slot.mEvents[0]));
+    hash = Hash(hash, slot.mRockets, rockets * sizeof(slot.mRockets[0]));
+    // Zero means that the checksums are off
+    return hash ? hash : 1;
+}
+
+//------------------------------------------------------------------------------------
+// SharedMemory
+
+SharedMemory::~SharedMemory()
+{
+    Close();
+}
+
+bool SharedMemory::Create(const std::string& name, size_t size)
+{
+    Close();
+    std::string system_name = SystemName(name);
+
+#if defined(ENGINE_TARGET_WIN32)
+    uint64_t size64 = size;
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64),
+                                        system_name.c_str());
+    if (!mapping)
+        return false;
+
+    void* base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!base)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    mMapping = mapping;
+#else
+    // The memory of the crashed server is replaced
+    shm_unlink(system_name.c_str());
+    int fd = shm_open(system_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+
+    void* base = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        shm_unlink(system_name.c_str());
+        return false;
+    }
+#endif
+
+    mName = system_name;
+    mBase = base;
+    mSize = size;
+    mOwner = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name)
+{
+    Close();
+    std::string system_name = SystemName(name);
+
+#if defined(ENGINE_TARGET_WIN32)
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, system_name.c_str());
+    if (!mapping)
+        return false;
+
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (!base || !VirtualQuery(base, &info, sizeof(info)))
+    {
+        if (base)
+            UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        return false;
+    }
+    mMapping = mapping;
+    mSize = info.RegionSize;
+#else
+    int fd = shm_open(system_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return false;
+    mSize = static_cast<size_t>(st.st_size);
+#endif
+
+    mName = system_name;
+    mBase = base;
+    mOwner = false;
+    return true;
+}
+
+void SharedMemory::Close()
+{
+#if defined(ENGINE_TARGET_WIN32)
+    if (mBase)
+        UnmapViewOfFile(mBase);
+    if (mMapping)
+        CloseHandle(mMapping);
+#else
+    if (mBase)
+        munmap(mBase, mSize);
+    if (mBase && mOwner)
+        shm_unlink(mName.c_str());
+#endif
+    mBase = nullptr;
+    mMapping = nullptr;
+    mSize = 0;
+    mOwner = false;
+}
+
+//------------------------------------------------------------------------------------
+// WorldWriter
+
+bool WorldWriter::Create(const std::string& name)
+{
+    if (!mMemory.Create(name, SLOTS_OFFSET + SHARED_SLOTS * sizeof(SharedSlot)))
+    {
+        Log::log.WriteError("Can not create the shared memory " + name);
+        return false;
+    }
+
+    // The new memory is zeroed, but the existing Win32 section keeps the frames of the previous server.
+    // The signature is cleared first, then the counters and the slot sizes are written again.
+    auto base = static_cast<uint8_t*>(mMemory.Data());
+    mHeader = reinterpret_cast<SharedHeader*>(base);
+    mHeader->mMagic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    mSlots = reinterpret_cast<SharedSlot*>(base + SLOTS_OFFSET);
+    for (int i = 0; i < SHARED_SLOTS; i++)
+    {
+        auto& slot = mSlots[i];
+        new (&slot.mSequence) std::atomic<uint64_t>(0);
+        slot.mTick = 0;
+        slot.mGunCount = 0;
+        slot.mRocketCount = 0;
+        slot.mEventCount = 0;
+        slot.mChecksum = 0;
+    }
+
+    // Readers check the signature, so it is written the last
+    new (&mHeader->mLatest) std::atomic<uint64_t>(0);
+    mHeader->mVersion = SHARED_VERSION;
+    mHeader->mSlotSize = sizeof(SharedSlot);
+    mHeader->mSlotCount = SHARED_SLOTS;
+    mHeader->mInstance = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) | 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    mHeader->mMagic = SHARED_MAGIC;
+    return true;
+}
+
+void WorldWriter::Publish(const weapons::WorldSnapshot& snapshot, const weapons::WorldEvent* events, size_t count)
+{
+    if (!mHeader)
+        return;
+
+    auto& slot = mSlots[snapshot.mTick % SHARED_SLOTS];
+    uint64_t sequence = slot.mSequence.load(std::memory_order_relaxed);
+    slot.mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.mTick = snapshot.mTick;
+    slot.mGunCount = static_cast<uint32_t>(std::min<size_t>(snapshot.mGunX.size(), SHARED_MAX_GUNS));
+    slot.mRocketCount = static_cast<uint32_t>(std::min<size_t>(snapshot.mRockets.size(), ROCKET_CAPACITY));
+    slot.mEventCount = static_cast<uint32_t>(std::min<size_t>(count, SHARED_MAX_EVENTS));
+    if (slot.mGunCount)
+        memcpy(slot.mGunX, snapshot.mGunX.data(), slot.mGunCount * sizeof(slot.mGunX[0]));
+    if (slot.mRocketCount)
+        memcpy(slot.mRockets, snapshot.mRockets.data(), slot.mRocketCount * sizeof(slot.mRockets[0]));
+    if (slot.mEventCount)
+        memcpy(slot.mEvents, events, slot.mEventCount * sizeof(slot.mEvents[0]));
+    slot.mChecksum = mChecksums ? FrameChecksum(slot) : 0;
+
+    slot.mSequence.store(sequence + 2, std::memory_order_release);
+    mHeader->mLatest.store(snapshot.mTick, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------------
+// WorldReader
+
+bool WorldReader::Open(const std::string& name)
+{
+    mHeader = nullptr;
+    mSlots = nullptr;
+    if (!mMemory.Open(name) || mMemory.Size() < SLOTS_OFFSET + SHARED_SLOTS * sizeof(SharedSlot))
+    {
+        mMemory.Close();
+        return false;
+    }
+
+    auto base = static_cast<const uint8_t*>(mMemory.Data());
+    auto header = reinterpret_cast<const SharedHeader*>(base);
+    bool valid = header->mMagic == SHARED_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid || header->mVersion != SHARED_VERSION || header->mSlotSize != sizeof(SharedSlot) ||
+        header->mSlotCount != SHARED_SLOTS)
+    {
+        mMemory.Close();
+        return false;
+    }
+
+    mHeader = header;
+    mSlots = reinterpret_cast<const SharedSlot*>(base + SLOTS_OFFSET);
+    return true;
+}
+
+uint64_t WorldReader::LatestTick() const
+{
+    return mHeader ? mHeader->mLatest.load(std::memory_order_acquire) : 0;
+}
+
+bool WorldReader::Acquire(uint64_t tick, SharedFrame& frame) const
+{
+    uint64_t latest = LatestTick();
+    if (!tick || tick > latest || latest - tick >= SHARED_SLOTS)
+        return false;
+
+    const auto& slot = mSlots[tick % SHARED_SLOTS];
+    uint64_t sequence = slot.mSequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+        return false;
+
+    // Counts are clamped, so the torn frame can not point outside the slot
+    auto guns = std::min<uint32_t>(slot.mGunCount, SHARED_MAX_GUNS);
+    auto rockets = std::min<uint32_t>(slot.mRocketCount, ROCKET_CAPACITY);
+    auto events = std::min<uint32_t>(slot.mEventCount, SHARED_MAX_EVENTS);
+    frame.mView.mTick = slot.mTick;
+    frame.mView.mGunX = { slot.mGunX, slot.mGunX + guns };
+    frame.mView.mRockets = { slot.mRockets, slot.mRockets + rockets };
+    frame.mEvents = { slot.mEvents, slot.mEvents + events };
+    frame.mSlot = &slot;
+    frame.mSequence = sequence;
+    return Validate(frame) && frame.mView.mTick == tick;
+}
+
+bool WorldReader::Validate(const SharedFrame& frame) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frame.mSlot && frame.mSlot->mSequence.load(std::memory_order_relaxed) == frame.mSequence;
+}
+
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+/**
+ * \file
+ * \brief World snapshots of the simulation server in the shared memory
+ * \author Maksimovskiy A.S.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "Params.h"
+#include "SaluteGun.h"
+
+
+namespace shm
+{
+
+// Shared memory signature and format version
+constexpr uint32_t SHARED_MAGIC = 0x444C5753; // "SWLD"
+constexpr uint32_t SHARED_VERSION = 2;
+
+// Ring of the frames: the server writes the frame of the tick into the slot tick % SHARED_SLOTS,
+// so the renderer has SHARED_SLOTS - 1 ticks to draw the frame before it is written again
+constexpr int SHARED_SLOTS = 8;
+// Max guns and events of one frame, rockets are limited by ROCKET_CAPACITY
+constexpr int SHARED_MAX_GUNS = 64;
+constexpr int SHARED_MAX_EVENTS = 4096;
+// Time in seconds without new frames, after which the reader maps the memory again.
+// The restarted POSIX server creates a new memory, the old mapping is never written again.
+constexpr double SHARED_STALL_TIME = 1.0;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Sequence counters in the shared memory must be lock-free");
+static_assert(std::is_trivially_copyable<weapons::RocketState>::value &&
+              std::is_trivially_copyable<weapons::WorldEvent>::value,
+              "Shared frames must be trivially copyable");
+
+// Frame of one tick. The sequence counter is odd while the frame is written,
+// the reader checks that it did not change after the reading (seqlock).
+struct SharedSlot
+{
+    std::atomic<uint64_t> mSequence;
+    uint64_t mTick;
+    uint32_t mGunCount;
+    uint32_t mRocketCount;
+    uint32_t mEventCount;
+    // FNV-1a hash of the frame data or zero, if the checksums are off
+    uint32_t mChecksum;
+    int mGunX[SHARED_MAX_GUNS];
+    weapons::WorldEvent mEvents[SHARED_MAX_EVENTS];
+    weapons::RocketState mRockets[ROCKET_CAPACITY];
+};
+
+// Beginning of the shared memory, the slots follow it
+struct SharedHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint64_t mSlotSize;
+    uint32_t mSlotCount;
+    // Id of the server, which created the memory, it differs after the restart of the server
+    uint64_t mInstance;
+    // Tick of the last written frame, zero before the first one
+    alignas(64) std::atomic<uint64_t> mLatest;
+};
+
+// Frame of the reader. Its data point into the shared memory.
+struct SharedFrame
+{
+    weapons::SnapshotView mView;
+    utils::ArrayRange<weapons::WorldEvent> mEvents;
+    const SharedSlot* mSlot = nullptr;
+    uint64_t mSequence = 0;
+};
+
+// Checksum of the frame data
+uint32_t FrameChecksum(const SharedSlot& slot);
+
+//------------------------------------------------------------------------------------
+// Named shared memory: POSIX shm_open or the Win32 file mapping
+class SharedMemory
+{
+public:
+    SharedMemory() = default;
+    ~SharedMemory();
+
+    // Create the memory for writing. The old memory with the name is replaced.
+    bool Create(const std::string& name, size_t size);
+
+    // Map the memory for reading
+    bool Open(const std::string& name);
+
+    // Unmap the memory, the created one is removed
+    void Close();
+
+    // Beginning and size of the mapped memory
+    void* Data() const { return mBase; }
+    size_t Size() const { return mSize; }
+
+private:
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    std::string mName;
+    void* mBase = nullptr;
+    size_t mSize = 0;
+    bool mOwner = false;
+    // Native handle of the mapping
+    void* mMapping = nullptr;
+};
+
+//------------------------------------------------------------------------------------
+// Server side: writes the frame of every tick into the ring. There is only one writer.
+class WorldWriter
+{
+public:
+    WorldWriter() = default;
+
+    // Create the shared memory
+    bool Create(const std::string& name);
+
+    // Write the snapshot and the events of its tick. Extra guns, rockets and events are cut.
+    void Publish(const weapons::WorldSnapshot& snapshot, const weapons::WorldEvent* events, size_t count);
+
+    // Write the checksums of the frames, which are checked by the readers of the test harness
+    void SetChecksums(bool enabled) { mChecksums = enabled; }
+
+private:
+    SharedMemory mMemory;
+    SharedHeader* mHeader = nullptr;
+    SharedSlot* mSlots = nullptr;
+    bool mChecksums = false;
+};
+
+//------------------------------------------------------------------------------------
+// Renderer side: maps the ring read-only. Any number of readers in any processes.
+class WorldReader
+{
+public:
+    WorldReader() = default;
+
+    // Map the shared memory of the server. Returns false if there is no server or its format differs.
+    bool Open(const std::string& name);
+
+    // Check that the memory is mapped
+    bool IsOpen() const { return mHeader != nullptr; }
+
+    // Id of the server, which created the mapped memory, zero if it is not mapped
+    uint64_t Instance() const { return mHeader ? mHeader->mInstance : 0; }
+
+    // Tick of the last written frame, zero if there is none
+    uint64_t LatestTick() const;
+
+    // Frame of the tick. Returns false if the frame is written now or was already replaced.
+    bool Acquire(uint64_t tick, SharedFrame& frame) const;
+
+    // Check that the server did not write the slot of the frame after Acquire,
+    // so everything, which was read from the frame, is consistent
+    bool Validate(const SharedFrame& frame) const;
+
+private:
+    SharedMemory mMemory;
+    const SharedHeader* mHeader = nullptr;
+    const SharedSlot* mSlots = nullptr;
+};
+
+}
@@ -0,0 +1,235 @@
+/**
+ * \file
+ * \brief Implementation of the show schedule and player
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "ShowTimeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "Params.h"
+#include "Utils.h"
+
+
+namespace show
+{
+
+namespace
+{
+
+// Keyword of the audio line
+const std::string AUDIO_KEY = "audio";
+
+// Find the salute type by name. Returns -1 if there is no such type.
+int SaluteTypeIndex(const std::string& name)
+{
+    int index = 0;
+    for (auto& type : Config::SaluteTypes())
+    {
+        if (type.first == name)
+            return index;
+        ++index;
+    }
+    return -1;
+}
+
+}
+
+//------------------------------------------------------------------------------------
+// ShowSchedule
+
+bool ShowSchedule::Attach(const uint8_t* data, size_t size)
+{
+    if (size < sizeof(ShowHeader))
+        return false;
+
+    auto header = reinterpret_cast<const ShowHeader*>(data);
+    if (header->mMagic != SHOW_MAGIC || header->mVersion != SHOW_VERSION ||
+        sizeof(ShowHeader) + static_cast<uint64_t>(header->mCount) * sizeof(ShowLaunch) > size)
+        return false;
+
+    // Player takes the launches by the cursor and seeks by the binary search, so they must be sorted
+    auto launches = reinterpret_cast<const ShowLaunch*>(data + sizeof(ShowHeader));
+    float prev_time = 0.0f;
+    for (uint32_t i = 0; i < header->mCount; i++)
+    {
+        float time = launches[i].mTime;
+        if (!std::isfinite(time) || time < prev_time)
+            return false;
+        prev_time = time;
+    }
+
+    mLaunches = launches;
+    mCount = header->mCount;
+    mAudio.assign(header->mAudio, strnlen(header->mAudio, SHOW_AUDIO_SIZE));
+    return true;
+}
+
+bool ShowSchedule::Load(const std::string& name)
+{
+    // The compiled show is used in place of the read file
+    if (utils::ReadGameFile(name + ".show", mCompiled))
+    {
+        if (Attach(mCompiled.data(), mCompiled.size()))
+        {
+            mAudioSample = mAudio.empty() ? res::NO_HANDLE : res::Registry::Instance().Register(mAudio);
+            return true;
+        }
+
+        Log::log.WriteError("Broken show: " + name + ".show");
+        return false;
+    }
+
+    std::vector<uint8_t> text;
+    if (!utils::ReadGameFile(name + ".txt", text))
+        return false;
+
+    int error_line = 0;
+    if (!Parse(reinterpret_cast<const char*>(text.data()), text.size(), error_line))
+    {
+        Log::log.WriteError("Show " + name + ".txt: error in line " + std::to_string(error_line));
+        return false;
+    }
+    mAudioSample = mAudio.empty() ? res::NO_HANDLE : res::Registry::Instance().Register(mAudio);
+    return true;
+}
+
+bool ShowSchedule::Parse(const char* text, size_t size, int& error_line)
+{
+    // Line: <time> <gun> <angle> <salute type> <depth>
+    // or: audio <sample name>
+    mParsed.clear();
+    mAudio.clear();
+    std::istringstream input(std::string(text, size));
+    std::string line;
+    error_line = 0;
+    while (std::getline(input, line))
+    {
+        ++error_line;
+        auto comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first))
+            continue;
+
+        if (first == AUDIO_KEY)
+        {
+            if (!(fields >> mAudio) || mAudio.size() >= SHOW_AUDIO_SIZE)
+                return false;
+            continue;
+        }
+
+        ShowLaunch launch;
+        std::string type_name;
+        int gun = 0;
+        int depth = 0;
+        char* end = nullptr;
+        launch.mTime = strtof(first.c_str(), &end);
+        if (*end || !(fields >> gun >> launch.mAngle >> type_name >> depth))
+            return false;
+
+        int type = SaluteTypeIndex(type_name);
+        if (type < 0 || gun < 0 || gun > UINT16_MAX || depth < 0 || depth > UINT8_MAX ||
+            !std::isfinite(launch.mTime) || launch.mTime < 0)
+            return false;
+
+        launch.mGun = static_cast<uint16_t>(gun);
+        launch.mSaluteType = static_cast<uint8_t>(type);
+        launch.mDepth = static_cast<uint8_t>(depth);
+        mParsed.push_back(launch);
+    }
+
+    std::stable_sort(mParsed.begin(), mParsed.end(), [](const ShowLaunch& lhs, const ShowLaunch& rhs)
+    {
+        return lhs.mTime < rhs.mTime;
+    });
+    mLaunches = mParsed.data();
+    mCount = mParsed.size();
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+// ShowPlayer
+
+size_t ShowPlayer::Advance(float dt, const ShowLaunch*& first)
+{
+    if (!mSchedule)
+        return 0;
+
+    mTime += dt;
+    auto launches = mSchedule->Launches();
+    size_t count = mSchedule->Count();
+    size_t begin = mCursor;
+    while (mCursor < count && launches[mCursor].mTime <= mTime)
+        ++mCursor;
+
+    first = launches + begin;
+    return mCursor - begin;
+}
+
+void ShowPlayer::Play(std::shared_ptr<const ShowSchedule> schedule)
+{
+    mSchedule = std::move(schedule);
+    mTime = 0.0;
+    mCursor = 0;
+}
+
+void ShowPlayer::Seek(double time)
+{
+    if (!mSchedule)
+        return;
+
+    auto launches = mSchedule->Launches();
+    auto end = launches + mSchedule->Count();
+    auto found = std::lower_bound(launches, end, time, [](const ShowLaunch& launch, double value)
+    {
+        return launch.mTime < value;
+    });
+    mTime = time;
+    mCursor = found - launches;
+}
+
+void ShowPlayer::Stop()
+{
+    mSchedule.reset();
+    mTime = 0.0;
+    mCursor = 0;
+}
+
+//------------------------------------------------------------------------------------
+
+int CompileShow(const std::string& text_path, const std::string& show_path)
+{
+    std::ifstream in(text_path, std::ios::binary);
+    if (!in)
+        return -1;
+
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ShowSchedule schedule;
+    int error_line = 0;
+    if (!schedule.Parse(text.data(), text.size(), error_line))
+        return -1;
+
+    std::ofstream out(show_path, std::ios::binary | std::ios::trunc);
+    ShowHeader header = {};
+    header.mMagic = SHOW_MAGIC;
+    header.mVersion = SHOW_VERSION;
+    header.mCount = static_cast<uint32_t>(schedule.Count());
+    memcpy(header.mAudio, schedule.Audio().data(), schedule.Audio().size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(schedule.Launches()), schedule.Count() * sizeof(ShowLaunch));
+    return out ? static_cast<int>(schedule.Count()) : -1;
+}
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Choreographed show: text format, compiled schedule and its player
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ResourceIds.h"
+
+namespace show
+{
+
+// Compiled show signature and format version
+constexpr uint32_t SHOW_MAGIC = 0x574F4853; // "SHOW"
+constexpr uint32_t SHOW_VERSION = 1;
+// Max length of the audio sample name
+constexpr size_t SHOW_AUDIO_SIZE = 32;
+
+// Header of the compiled show
+struct ShowHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    // Number of the launches after the header
+    uint32_t mCount;
+    // Sample, which is played with the show, or empty string
+    char mAudio[SHOW_AUDIO_SIZE];
+};
+
+// Launch of the show. Launches are sorted by time.
+struct ShowLaunch
+{
+    // Time from the show start in seconds
+    float mTime;
+    // Launch angle in degrees, 90 is straight up
+    float mAngle;
+    // Gun of the battery
+    uint16_t mGun;
+    // Index in Config::SaluteTypes()
+    uint8_t mSaluteType;
+    // Depth of the chain reaction
+    uint8_t mDepth;
+};
+
+//------------------------------------------------------------------------------------
+// Schedule of the show. The compiled show is used in place without copying,
+// the text show is parsed (it is convenient for the development).
+class ShowSchedule
+{
+public:
+    ShowSchedule() = default;
+
+    // Load "<name>.show" or "<name>.txt" from the game files
+    bool Load(const std::string& name);
+
+    // Parse the text show. Returns false and the line number on error.
+    bool Parse(const char* text, size_t size, int& error_line);
+
+    // Launches sorted by time
+    const ShowLaunch* Launches() const { return mLaunches; }
+    size_t Count() const { return mCount; }
+
+    // Sample of the show
+    const std::string& Audio() const { return mAudio; }
+    // Handle of the sample, it is resolved by the loading
+    res::Handle AudioSample() const { return mAudioSample; }
+
+    // Time of the last launch
+    float Duration() const { return mCount ? mLaunches[mCount - 1].mTime : 0.0f; }
+
+private:
+    ShowSchedule(const ShowSchedule&) = delete;
+    ShowSchedule& operator=(const ShowSchedule&) = delete;
+
+    // Use the compiled show. Returns false if the data is broken
+    // or its launch times are not finite, negative or not sorted.
+    bool Attach(const uint8_t* data, size_t size);
+
+    const ShowLaunch* mLaunches = nullptr;
+    size_t mCount = 0;
+    std::string mAudio;
+    res::Handle mAudioSample = res::NO_HANDLE;
+
+    // Launches of the text show
+    std::vector<ShowLaunch> mParsed;
+
+    // Data of the compiled show
+    std::vector<uint8_t> mCompiled;
+};
+
+//------------------------------------------------------------------------------------
+// Player of the show. Every step costs O(1) plus the due launches.
+class ShowPlayer
+{
+public:
+    ShowPlayer() = default;
+
+    // Start the show from the beginning
+    void Play(std::shared_ptr<const ShowSchedule> schedule);
+
+    // Stop the show
+    void Stop();
+
+    // Move to the time of the show
+    void Seek(double time);
+
+    // Check that the show is played
+    bool IsPlaying() const { return mSchedule != nullptr; }
+
+    // Check that all launches of the show were taken
+    bool IsFinished() const { return mSchedule && mCursor == mSchedule->Count(); }
+
+    // Schedule of the played show
+    const ShowSchedule* Schedule() const { return mSchedule.get(); }
+
+    // Current time of the show
+    double Time() const { return mTime; }
+
+    // Advance the show time. Returns the number of the due launches, they start from first.
+    size_t Advance(float dt, const ShowLaunch*& first);
+
+private:
+    std::shared_ptr<const ShowSchedule> mSchedule;
+
+    // Current time of the show. It is summed in double, so a long show does not drift.
+    double mTime = 0.0;
+
+    // Next launch
+    size_t mCursor = 0;
+};
+
+//------------------------------------------------------------------------------------
+// Compile the text show into the binary schedule. Returns number of launches or -1 on error.
+int CompileShow(const std::string& text_path, const std::string& show_path);
+
+}
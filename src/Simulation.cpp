@@ -0,0 +1,415 @@
+/**
+ * \file
+ * \brief Implementation of the salute simulation thread
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "Simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Metrics.h"
+#include "Profiler.h"
+
+
+namespace weapons
+{
+
+// Time of one step of the simulation thread
+static const std::chrono::microseconds STEP_PERIOD(1000000 / SIMULATION_RATE);
+// Max steps, which catch up the lag after a stall, the rest of the lag is dropped
+static const int MAX_CATCHUP_STEPS = 4;
+
+namespace
+{
+
+// Saved values of the simulation, the battery follows them
+struct SimulationState
+{
+    float mWindTime;
+    double mShowTime;
+    uint64_t mShowPeak;
+    bool mPaused;
+    bool mShowPlaying;
+    bool mShowTracked;
+};
+
+}
+
+Simulation::Simulation()
+    : mVirtualTime(false),
+    mRunning(false),
+    mPaused(false),
+    mShowTracked(false),
+    mShowPeak(0),
+    mLastShowPeak(0),
+    mWindTime(0.0f),
+    mStateReady(false),
+    mRestoredReady(false),
+    mStateAllocs(0),
+    mTick(0),
+    mLastInput(0),
+    mSteadyAllocSteps(0)
+{
+    // Snapshots of the steady steps are written without the allocations
+    mSnapshots.InitAll([](WorldSnapshot& snapshot)
+    {
+        snapshot.mRockets.reserve(ROCKET_CAPACITY);
+    });
+}
+
+Simulation::~Simulation()
+{
+    Stop();
+}
+
+void Simulation::ApplyCommands()
+{
+    static auto& queue_histogram = metrics::Registry::Instance().GetHistogram("input.queue_us");
+    Command command;
+    while (mCommands.Pop(command))
+    {
+        // Input events are applied by the first step after the capture in their order,
+        // the snapshot of the step reflects them
+        if (command.mInputId)
+        {
+            double wait = utils::WallClock::Instance().Now() - command.mInputTime;
+            queue_histogram.Record(static_cast<uint64_t>(std::max(0.0, wait) * 1000000.0));
+            mLastInput = command.mInputId;
+        }
+
+        switch (command.mType)
+        {
+        case Command::MOVE_LEFT:
+            mBattery.Move();
+            break;
+        case Command::MOVE_RIGHT:
+            mBattery.Move(false);
+            break;
+        case Command::SHOT:
+            if (command.mForced)
+                mBattery.ResetHandShot();
+            mBattery.Shot(true);
+            break;
+        case Command::MOUSE_SHOT:
+            if (command.mForced)
+                mBattery.ResetHandShot();
+            mBattery.MouseShot(command.mX, command.mY);
+            break;
+        case Command::PAUSE:
+            mPaused = true;
+            mBattery.OnPausedMoving(true);
+            break;
+        case Command::RESUME:
+            mPaused = false;
+            mBattery.OnPausedMoving(false);
+            break;
+        case Command::STOP:
+            mBattery.InitRockets(true);
+            break;
+        case Command::SET_EFFECT:
+            mBattery.SetEffect(static_cast<res::Handle>(command.mX));
+            break;
+        case Command::SET_LEVEL_LIMIT:
+            mBattery.SetLevelLimit(command.mX);
+            break;
+        case Command::PLAY_SHOW:
+            // Guns fire only by the show
+            ReportShowPeak();
+            mShowPlayer.Play(std::move(command.mShow));
+            mBattery.SetAutoShot(!mShowPlayer.IsPlaying());
+            mShowTracked = mShowPlayer.IsPlaying();
+            mShowPeak = 0;
+            if (mShowPlayer.IsPlaying() && mShowPlayer.Schedule()->AudioSample() != res::NO_HANDLE)
+                mEvents.Push({ WorldEvent::SHOW_AUDIO, 0.0f, 0.0f, mShowPlayer.Schedule()->AudioSample() });
+            break;
+        case Command::SEEK_SHOW:
+            mShowPlayer.Seek(command.mX / 1000.0);
+            break;
+        case Command::STOP_SHOW:
+            mShowPlayer.Stop();
+            mBattery.SetAutoShot(true);
+            ReportShowPeak();
+            break;
+        case Command::SET_WIND:
+            mWind = std::move(command.mWind);
+            mBattery.SetWind(mWind.get());
+            break;
+        case Command::SET_AIM_MODE:
+            mBattery.SetAimMode(command.mX != 0);
+            break;
+        case Command::SET_FAN_OUT:
+            mBattery.SetFanOut(command.mX);
+            break;
+        case Command::SAVE_STATE:
+        {
+            auto start_allocs = memory::ThreadStats();
+            SaveState();
+            mStateAllocs += (memory::ThreadStats() - start_allocs).mCount;
+            break;
+        }
+        case Command::RESTORE_STATE:
+        {
+            auto start_allocs = memory::ThreadStats();
+            if (command.mState)
+                RestoreState(*command.mState, command.mHandleCount, std::move(command.mShow));
+            mStateAllocs += (memory::ThreadStats() - start_allocs).mCount;
+            break;
+        }
+        }
+    }
+}
+
+bool Simulation::PopEvent(WorldEvent& event)
+{
+    return mEvents.Pop(event);
+}
+
+void Simulation::Post(const Command& command)
+{
+    // The queue is full only if the simulation thread is hung, so the command is dropped
+    mCommands.Push(command);
+}
+
+void Simulation::Post(Command::Type type, int x, int y)
+{
+    Command command;
+    command.mType = type;
+    command.mX = x;
+    command.mY = y;
+    Post(command);
+}
+
+void Simulation::ReportShowPeak()
+{
+    static auto& peak_gauge = metrics::Registry::Instance().GetGauge("show.peak_rockets");
+    if (!mShowTracked)
+        return;
+
+    mShowTracked = false;
+    mLastShowPeak = mShowPeak;
+    peak_gauge.Set(static_cast<double>(mShowPeak));
+}
+
+void Simulation::SaveState()
+{
+    static auto& save_histogram = metrics::Registry::Instance().GetHistogram("state.save_us");
+    // The render thread did not take the previous state yet
+    if (mStateReady.load(std::memory_order_acquire))
+        return;
+
+    auto start_time = std::chrono::steady_clock::now();
+    save::Writer writer(mSavedState, sizeof(Rocket));
+    SimulationState state = { mWindTime, mShowPlayer.Time(), mShowPeak,
+                              mPaused, mShowPlayer.IsPlaying(), mShowTracked };
+    writer.Pod(state);
+    mBattery.Save(writer);
+    writer.Finish();
+    mStateReady.store(true, std::memory_order_release);
+
+    auto save_time = std::chrono::steady_clock::now() - start_time;
+    save_histogram.Record(std::chrono::duration_cast<std::chrono::microseconds>(save_time).count());
+}
+
+bool Simulation::RestoreState(const std::vector<uint8_t>& state, size_t handle_count,
+                              std::shared_ptr<const show::ShowSchedule> show)
+{
+    static auto& failed_counter = metrics::Registry::Instance().GetCounter("state.restore_failed");
+    save::Reader reader(state.data(), state.size(), sizeof(Rocket));
+    SimulationState values;
+    bool valid = reader.Pod(values) && std::isfinite(values.mWindTime) &&
+                 std::isfinite(values.mShowTime) && values.mShowTime >= 0.0;
+    // The battery is changed only by the valid state, it is the last section
+    if (!valid || !mBattery.Restore(reader, handle_count))
+    {
+        failed_counter.Add();
+        return false;
+    }
+
+    mBattery.SetWind(mWind.get());
+    mWindTime = values.mWindTime;
+    mPaused = values.mPaused;
+    // The show is taken from the command, its launches before the saved time are skipped
+    mShowPlayer.Stop();
+    if (values.mShowPlaying && show)
+    {
+        mShowPlayer.Play(std::move(show));
+        mShowPlayer.Seek(values.mShowTime);
+    }
+    else if (values.mShowPlaying)
+        mBattery.SetAutoShot(true);
+    mShowTracked = values.mShowTracked && mShowPlayer.IsPlaying();
+    mShowPeak = static_cast<size_t>(values.mShowPeak);
+
+    // All guns have the same settings. The render thread did not take the previous ones yet, if the flag is set.
+    if (!mRestoredReady.load(std::memory_order_acquire))
+    {
+        mRestored.mLevelLimit = mBattery.Gun(0).LevelLimit();
+        mRestored.mEffect = mBattery.Gun(0).Effect();
+        mRestoredReady.store(true, std::memory_order_release);
+    }
+    return true;
+}
+
+void Simulation::Run()
+{
+    PROFILE_THREAD("Simulation");
+    using Clock = std::chrono::steady_clock;
+    const float step_time = 1.0f / SIMULATION_RATE;
+    auto prev_time = Clock::now();
+    auto next_step = prev_time;
+    // The world is stepped with the fixed time, the measured time is accumulated
+    double lag = 0.0;
+    while (mRunning.load(std::memory_order_relaxed))
+    {
+        auto curr_time = Clock::now();
+        lag += std::chrono::duration<double>(curr_time - prev_time).count();
+        prev_time = curr_time;
+        int steps = 0;
+        for (; lag >= step_time && steps < MAX_CATCHUP_STEPS; steps++)
+        {
+            Update(step_time);
+            lag -= step_time;
+        }
+        // After a long stall the world is slowed down instead of the spiral of the catch-up steps
+        if (steps == MAX_CATCHUP_STEPS)
+            lag = std::min(lag, static_cast<double>(step_time));
+
+        next_step += STEP_PERIOD;
+        if (next_step < curr_time)
+            next_step = curr_time;
+        std::this_thread::sleep_until(next_step);
+    }
+}
+
+bool Simulation::TakeState(std::vector<uint8_t>& state)
+{
+    if (!mStateReady.load(std::memory_order_acquire))
+        return false;
+
+    state.swap(mSavedState);
+    mStateReady.store(false, std::memory_order_release);
+    return true;
+}
+
+bool Simulation::TakeRestored(RestoredSettings& settings)
+{
+    if (!mRestoredReady.load(std::memory_order_acquire))
+        return false;
+
+    settings = mRestored;
+    mRestoredReady.store(false, std::memory_order_release);
+    return true;
+}
+
+const WorldSnapshot& Simulation::Snapshot()
+{
+    mSnapshots.Update();
+    return mSnapshots.Front();
+}
+
+void Simulation::SetVirtualTime(bool enabled)
+{
+    mVirtualTime = enabled;
+    mBattery.SetClock(enabled ? static_cast<const utils::Clock*>(&mVirtualClock) : &utils::WallClock::Instance());
+}
+
+void Simulation::Start()
+{
+    if (mRunning.exchange(true))
+        return;
+
+    mThread = std::thread(&Simulation::Run, this);
+}
+
+void Simulation::Stop()
+{
+    if (!mRunning.exchange(false))
+        return;
+
+    if (mThread.joinable())
+        mThread.join();
+}
+
+void Simulation::UpdateShow(float dt)
+{
+    if (mPaused || !mShowPlayer.IsPlaying())
+        return;
+
+    const show::ShowLaunch* launches = nullptr;
+    size_t count = mShowPlayer.Advance(dt, launches);
+    for (size_t i = 0; i < count; i++)
+        mBattery.Launch(launches[i]);
+    if (mShowPlayer.IsFinished())
+    {
+        mShowPlayer.Stop();
+        mBattery.SetAutoShot(true);
+    }
+}
+
+void Simulation::Update(float dt)
+{
+    PROFILE_ZONE("Simulation::Update");
+    static auto& step_histogram = metrics::Registry::Instance().GetHistogram("sim.step_us");
+    static auto& live_gauge = metrics::Registry::Instance().GetGauge("rockets.live");
+    static auto& allocs_histogram = metrics::Registry::Instance().GetHistogram("sim.step_allocs");
+    auto start_time = std::chrono::steady_clock::now();
+    auto start_allocs = memory::ThreadStats();
+
+    if (mVirtualTime)
+        mVirtualClock.Advance(dt);
+    ApplyCommands();
+    UpdateShow(dt);
+    if (mWind && !mPaused)
+    {
+        mWindTime += dt;
+        mWind->Animate(mWindTime);
+    }
+    mBattery.Update(dt);
+
+    // Events, which did not fit into the queue, are sent on the next step
+    for (size_t gun = 0; gun < mBattery.Count(); gun++)
+    {
+        auto& events = mBattery.Gun(gun).Events();
+        size_t sent = 0;
+        while (sent < events.size() && mEvents.Push(events[sent]))
+            ++sent;
+        events.erase(events.begin(), events.begin() + sent);
+    }
+
+    auto& snapshot = mSnapshots.Back();
+    snapshot.mTick = ++mTick;
+    snapshot.mLastInput = mLastInput;
+    mBattery.Publish(snapshot);
+    live_gauge.Set(static_cast<double>(snapshot.mRockets.size()));
+    if (mShowTracked)
+    {
+        mShowPeak = std::max(mShowPeak, snapshot.mRockets.size());
+        if (!mShowPlayer.IsPlaying() && snapshot.mRockets.empty())
+            ReportShowPeak();
+    }
+    mSnapshots.Publish();
+
+    auto step_time = std::chrono::steady_clock::now() - start_time;
+    step_histogram.Record(std::chrono::duration_cast<std::chrono::microseconds>(step_time).count());
+
+    // After the warm-up all containers have reached their capacity,
+    // so a step with allocations is a regression. Guns, which were stepped by the workers,
+    // are counted by the battery, the save and restore are not a part of the step.
+    uint64_t step_allocs = (memory::ThreadStats() - start_allocs).mCount - mStateAllocs + mBattery.WorkerAllocs();
+    mStateAllocs = 0;
+    allocs_histogram.Record(step_allocs);
+    if (mTick > ALLOC_WARMUP_STEPS && step_allocs)
+    {
+        if (!mSteadyAllocSteps)
+            Log::log.WriteWarn("Simulation step allocated " + std::to_string(step_allocs) +
+                               " blocks after the warm-up");
+        ++mSteadyAllocSteps;
+    }
+}
+
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Simulation of the salute in its own thread
+ * \author Maksimovskiy A.S.
+ */
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "AllocTracker.h"
+#include "Concurrency.h"
+#include "SaluteBattery.h"
+#include "ShowTimeline.h"
+#include "WindField.h"
+
+
+namespace weapons
+{
+
+// Command from the render thread to the simulation
+struct Command
+{
+    enum Type : uint8_t
+    {
+        MOVE_LEFT,
+        MOVE_RIGHT,
+        SHOT,
+        MOUSE_SHOT,
+        PAUSE,
+        RESUME,
+        STOP,
+        SET_EFFECT,
+        SET_LEVEL_LIMIT,
+        PLAY_SHOW,
+        SEEK_SHOW,
+        STOP_SHOW,
+        SET_WIND,
+        SET_AIM_MODE,
+        SET_FAN_OUT,
+        SAVE_STATE,
+        RESTORE_STATE
+    };
+
+    Type mType;
+    // Position for the mouse shot, the level limit, the salute effect, the show time in milliseconds,
+    // the flag of the aim mode or the fan-out
+    int mX = 0;
+    int mY = 0;
+    // Show for playing or the show of the restored state, if it was played
+    std::shared_ptr<const show::ShowSchedule> mShow;
+    // Saved state for restoring and the number of the registered resources, the handles of the state
+    // must be less than it. The simulation does not use the registry of the render thread.
+    std::shared_ptr<const std::vector<uint8_t>> mState;
+    size_t mHandleCount = 0;
+    // Input event of the command and its capture time on the wall clock, zero id means no input event
+    uint32_t mInputId = 0;
+    double mInputTime = 0.0;
+    // Wind of the city, null means calm. The simulation takes the ownership.
+    std::shared_ptr<WindField> mWind;
+    // The gun or mouse shot is not limited by the hand shot period, e.g. the shots of the scripted volley
+    bool mForced = false;
+};
+
+// Settings of the restored state, which are shown by the menu
+struct RestoredSettings
+{
+    int mLevelLimit = 0;
+    res::Handle mEffect = res::NO_HANDLE;
+};
+
+//------------------------------------------------------------------------------------
+// Class steps the battery of salute guns in the simulation thread.
+// The render thread sends commands and takes snapshots and events.
+class Simulation
+{
+public:
+    Simulation();
+    ~Simulation();
+
+    // Battery of the salute guns. It can be changed directly only before the start.
+    SaluteBattery& Battery() { return mBattery; }
+
+    // Render thread: send the command to the simulation
+    void Post(const Command& command);
+    void Post(Command::Type type, int x = 0, int y = 0);
+
+    // Render thread: take the next event of the simulation
+    bool PopEvent(WorldEvent& event);
+
+    // Render thread: latest published snapshot
+    const WorldSnapshot& Snapshot();
+
+    // Render thread: take the state, which was saved by the SAVE_STATE command.
+    // The buffers are swapped, so the capacity of the state is kept for the next save.
+    bool TakeState(std::vector<uint8_t>& state);
+
+    // Render thread: take the settings of the state, which was restored by the RESTORE_STATE command
+    bool TakeRestored(RestoredSettings& settings);
+
+    // Peak number of the live rockets of the last finished show
+    size_t LastShowPeak() const { return mLastShowPeak; }
+
+    // Take the time of the shot timers from the simulation steps instead of the wall clock,
+    // so the steps can be done as fast as possible without changing the shot periods.
+    // It is set before the start.
+    void SetVirtualTime(bool enabled);
+
+    // Simulated time of the virtual clock in seconds
+    double VirtualTime() const { return mVirtualClock.Now(); }
+
+    // Steps after the warm-up, which allocated heap memory.
+    // It is always zero without SALUTE_TRACK_ALLOCS.
+    uint64_t SteadyAllocSteps() const { return mSteadyAllocSteps; }
+
+    // Start the simulation thread
+    void Start();
+
+    // Stop the simulation thread
+    void Stop();
+
+    // Simulation step. It is called by the simulation thread
+    // or directly, if the thread was not started.
+    void Update(float dt);
+
+private:
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Apply all commands from the render thread
+    void ApplyCommands();
+
+    // Launch the due rockets of the show
+    void UpdateShow(float dt);
+
+    // Report the peak population of the tracked show and stop tracking it
+    void ReportShowPeak();
+
+    // Save the whole state into the buffer for the render thread
+    void SaveState();
+
+    // Restore the saved state. The broken state is counted and does not change the world.
+    bool RestoreState(const std::vector<uint8_t>& state, size_t handle_count,
+                      std::shared_ptr<const show::ShowSchedule> show);
+
+    // Loop of the simulation thread. The measured time is stepped by the fixed steps,
+    // a few steps catch up after a stall and the rest of the lag is dropped.
+    void Run();
+
+    // Commands from the render thread
+    utils::SpscQueue<Command, 256> mCommands;
+
+    // Events for the render thread
+    utils::SpscQueue<WorldEvent, 4096> mEvents;
+
+    // Salute guns with all rockets
+    SaluteBattery mBattery;
+
+    // Clock of the shot timers in the virtual time mode
+    utils::VirtualClock mVirtualClock;
+    bool mVirtualTime;
+
+    // Flag of the running simulation thread
+    std::atomic<bool> mRunning;
+
+    // Flag of the paused simulation, the show is paused too
+    bool mPaused;
+
+    // Player of the show
+    show::ShowPlayer mShowPlayer;
+
+    // Peak population is tracked from the start of the show until its last rocket is used
+    bool mShowTracked;
+    size_t mShowPeak;
+    size_t mLastShowPeak;
+
+    // Wind of the rockets and its animation time
+    std::shared_ptr<WindField> mWind;
+    float mWindTime;
+
+    // Snapshots for the render thread
+    utils::TripleBuffer<WorldSnapshot> mSnapshots;
+
+    // Saved state and the flag, that the render thread can take it
+    std::vector<uint8_t> mSavedState;
+    std::atomic<bool> mStateReady;
+
+    // Settings of the restored state and the flag, that the render thread can take them
+    RestoredSettings mRestored;
+    std::atomic<bool> mRestoredReady;
+
+    // Allocations of the saving and restoring on the current step, they are not regressions
+    uint64_t mStateAllocs;
+
+    // Simulation thread
+    std::thread mThread;
+
+    // Number of the simulation step
+    uint64_t mTick;
+
+    // Id of the last applied input event
+    uint32_t mLastInput;
+
+    // Steps after the warm-up, which allocated heap memory
+    uint64_t mSteadyAllocSteps;
+};
+
+}
@@ -0,0 +1,284 @@
+/**
+ * \file
+ * \brief Implementation of the software rasterizer
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "SoftRender.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "Profiler.h"
+
+
+namespace soft
+{
+
+namespace
+{
+
+// Tile size in pixels
+const int TILE_SIZE = 64;
+
+const float DEG_TO_RAD = 3.14159265f / 180.0f;
+
+// Multiply the colors channel by channel
+uint32_t Modulate(uint32_t lhs, uint32_t rhs)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t channel = ((lhs >> shift) & 0xFF) * ((rhs >> shift) & 0xFF) / 255;
+        result |= channel << shift;
+    }
+    return result;
+}
+
+uint32_t Blend(uint32_t dst, uint32_t src, BlendMode mode)
+{
+    uint32_t alpha = src >> 24;
+    if (!alpha)
+        return dst;
+
+    uint32_t result = 0xFF000000;
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        uint32_t d = (dst >> shift) & 0xFF;
+        uint32_t s = (src >> shift) & 0xFF;
+        uint32_t channel = mode == BlendMode::ADD ?
+            std::min<uint32_t>(255, d + s * alpha / 255) :
+            (s * alpha + d * (255 - alpha)) / 255;
+        result |= channel << shift;
+    }
+    return result;
+}
+
+}
+
+Image::Image(int width, int height, uint32_t color)
+    : mWidth(width),
+    mHeight(height),
+    mPixels(static_cast<size_t>(width) * height, color)
+{
+}
+
+Matrix Matrix::operator*(const Matrix& other) const
+{
+    Matrix result;
+    result.mA = mA * other.mA + mC * other.mB;
+    result.mB = mB * other.mA + mD * other.mB;
+    result.mC = mA * other.mC + mC * other.mD;
+    result.mD = mB * other.mC + mD * other.mD;
+    result.mTx = mA * other.mTx + mC * other.mTy + mTx;
+    result.mTy = mB * other.mTx + mD * other.mTy + mTy;
+    return result;
+}
+
+Matrix Matrix::Inverse() const
+{
+    Matrix result;
+    float det = mA * mD - mB * mC;
+    if (det == 0.0f)
+        return result;
+
+    result.mA = mD / det;
+    result.mB = -mB / det;
+    result.mC = -mC / det;
+    result.mD = mA / det;
+    result.mTx = -(result.mA * mTx + result.mC * mTy);
+    result.mTy = -(result.mB * mTx + result.mD * mTy);
+    return result;
+}
+
+//------------------------------------------------------------------------------------
+// Canvas
+
+Canvas::Canvas(int width, int height, size_t threads)
+    : mFrame(width, height),
+    mMatrices(1),
+    mBlend(BlendMode::ALPHA),
+    mColor(0xFFFFFFFF),
+    mTilesX((width + TILE_SIZE - 1) / TILE_SIZE),
+    mTilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+    mBins(static_cast<size_t>(mTilesX) * mTilesY),
+    mWorkers(threads)
+{
+}
+
+void Canvas::Clear(uint32_t color)
+{
+    std::fill(mFrame.mPixels.begin(), mFrame.mPixels.end(), color);
+    mQuads.clear();
+}
+
+void Canvas::DrawImage(const Image& texture)
+{
+    DrawQuad(0.0f, 0.0f, static_cast<float>(texture.mWidth), static_cast<float>(texture.mHeight), &texture);
+}
+
+void Canvas::DrawQuad(float x, float y, float width, float height, const Image* texture)
+{
+    const auto& matrix = mMatrices.back();
+    Quad quad;
+    quad.mInverse = matrix.Inverse();
+    quad.mX = x;
+    quad.mY = y;
+    quad.mWidth = width;
+    quad.mHeight = height;
+    quad.mTexture = texture;
+    quad.mColor = mColor;
+    quad.mBlend = mBlend;
+
+    // Bounding box of the transformed corners, the screen rows go down
+    float min_x = INFINITY, max_x = -INFINITY, min_y = INFINITY, max_y = -INFINITY;
+    for (int corner = 0; corner < 4; corner++)
+    {
+        float local_x = x + (corner & 1 ? width : 0.0f);
+        float local_y = y + (corner & 2 ? height : 0.0f);
+        float screen_x = matrix.mA * local_x + matrix.mC * local_y + matrix.mTx;
+        float screen_y = mFrame.mHeight - (matrix.mB * local_x + matrix.mD * local_y + matrix.mTy);
+        min_x = std::min(min_x, screen_x);
+        max_x = std::max(max_x, screen_x);
+        min_y = std::min(min_y, screen_y);
+        max_y = std::max(max_y, screen_y);
+    }
+    quad.mMinX = std::max(0, static_cast<int>(std::floor(min_x)));
+    quad.mMinY = std::max(0, static_cast<int>(std::floor(min_y)));
+    quad.mMaxX = std::min(mFrame.mWidth - 1, static_cast<int>(std::ceil(max_x)));
+    quad.mMaxY = std::min(mFrame.mHeight - 1, static_cast<int>(std::ceil(max_y)));
+    if (quad.mMinX > quad.mMaxX || quad.mMinY > quad.mMaxY)
+        return;
+
+    mQuads.push_back(quad);
+}
+
+void Canvas::DrawTile(size_t tile)
+{
+    int tile_x = static_cast<int>(tile % mTilesX) * TILE_SIZE;
+    int tile_y = static_cast<int>(tile / mTilesX) * TILE_SIZE;
+    int tile_max_x = std::min(tile_x + TILE_SIZE, mFrame.mWidth) - 1;
+    int tile_max_y = std::min(tile_y + TILE_SIZE, mFrame.mHeight) - 1;
+
+    for (uint32_t index : mBins[tile])
+    {
+        const auto& quad = mQuads[index];
+        const auto& inverse = quad.mInverse;
+        int min_x = std::max(quad.mMinX, tile_x);
+        int max_x = std::min(quad.mMaxX, tile_max_x);
+        int min_y = std::max(quad.mMinY, tile_y);
+        int max_y = std::min(quad.mMaxY, tile_max_y);
+        for (int row = min_y; row <= max_y; row++)
+        {
+            // Pixel centers in the game coordinates
+            float world_y = mFrame.mHeight - (row + 0.5f);
+            for (int column = min_x; column <= max_x; column++)
+            {
+                float world_x = column + 0.5f;
+                float u = (inverse.mA * world_x + inverse.mC * world_y + inverse.mTx - quad.mX) / quad.mWidth;
+                float v = (inverse.mB * world_x + inverse.mD * world_y + inverse.mTy - quad.mY) / quad.mHeight;
+                if (u < 0.0f || u >= 1.0f || v < 0.0f || v >= 1.0f)
+                    continue;
+
+                uint32_t color = quad.mColor;
+                if (quad.mTexture)
+                {
+                    const auto& texture = *quad.mTexture;
+                    int texel_x = static_cast<int>(u * texture.mWidth);
+                    int texel_y = texture.mHeight - 1 - static_cast<int>(v * texture.mHeight);
+                    color = Modulate(texture.At(texel_x, texel_y), color);
+                }
+                auto& pixel = mFrame.At(column, row);
+                pixel = Blend(pixel, color, quad.mBlend);
+            }
+        }
+    }
+}
+
+void Canvas::Flush()
+{
+    PROFILE_ZONE("Canvas::Flush");
+    for (auto& bin : mBins)
+        bin.clear();
+
+    for (uint32_t index = 0; index < mQuads.size(); index++)
+    {
+        const auto& quad = mQuads[index];
+        for (int tile_y = quad.mMinY / TILE_SIZE; tile_y <= quad.mMaxY / TILE_SIZE; tile_y++)
+            for (int tile_x = quad.mMinX / TILE_SIZE; tile_x <= quad.mMaxX / TILE_SIZE; tile_x++)
+                mBins[tile_y * mTilesX + tile_x].push_back(index);
+    }
+
+    auto draw_tile = [this](size_t tile)
+    {
+        DrawTile(tile);
+    };
+    mWorkers.Run(mBins.size(), draw_tile);
+    mQuads.clear();
+}
+
+uint64_t Canvas::Hash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t pixel : mFrame.mPixels)
+    {
+        hash ^= pixel;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void Canvas::MatrixRotate(float degrees)
+{
+    Matrix rotate;
+    float angle = degrees * DEG_TO_RAD;
+    rotate.mA = std::cos(angle);
+    rotate.mB = std::sin(angle);
+    rotate.mC = -rotate.mB;
+    rotate.mD = rotate.mA;
+    mMatrices.back() = mMatrices.back() * rotate;
+}
+
+void Canvas::MatrixScale(float x, float y)
+{
+    Matrix scale;
+    scale.mA = x;
+    scale.mD = y;
+    mMatrices.back() = mMatrices.back() * scale;
+}
+
+void Canvas::MatrixTranslate(float x, float y)
+{
+    Matrix translate;
+    translate.mTx = x;
+    translate.mTy = y;
+    mMatrices.back() = mMatrices.back() * translate;
+}
+
+void Canvas::PopMatrix()
+{
+    if (mMatrices.size() > 1)
+        mMatrices.pop_back();
+}
+
+void Canvas::PushMatrix()
+{
+    mMatrices.push_back(mMatrices.back());
+}
+
+bool Canvas::WritePpm(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << "P6\n" << mFrame.mWidth << ' ' << mFrame.mHeight << "\n255\n";
+    for (uint32_t pixel : mFrame.mPixels)
+    {
+        char rgb[3] = { static_cast<char>(pixel >> 16), static_cast<char>(pixel >> 8), static_cast<char>(pixel) };
+        out.write(rgb, sizeof(rgb));
+    }
+    return static_cast<bool>(out);
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Software rasterizer for the headless rendering
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Concurrency.h"
+
+
+namespace soft
+{
+
+// Image in memory, pixels are 0xAARRGGBB, the first row is the top one
+struct Image
+{
+    int mWidth = 0;
+    int mHeight = 0;
+    std::vector<uint32_t> mPixels;
+
+    Image() = default;
+    Image(int width, int height, uint32_t color = 0);
+
+    uint32_t& At(int x, int y) { return mPixels[y * mWidth + x]; }
+    uint32_t At(int x, int y) const { return mPixels[y * mWidth + x]; }
+};
+
+// Blending of the drawn pixels
+enum class BlendMode : uint8_t
+{
+    // Usual alpha blending
+    ALPHA,
+    // Additive blending of the effects
+    ADD
+};
+
+// 2D affine matrix: x' = a * x + c * y + tx, y' = b * x + d * y + ty
+struct Matrix
+{
+    float mA = 1.0f;
+    float mB = 0.0f;
+    float mC = 0.0f;
+    float mD = 1.0f;
+    float mTx = 0.0f;
+    float mTy = 0.0f;
+
+    Matrix operator*(const Matrix& other) const;
+    Matrix Inverse() const;
+};
+
+//------------------------------------------------------------------------------------
+// Canvas with the same drawing model as the render device: matrix stack,
+// textured quads and blending. The coordinates grow up, as in the game.
+// Quads are collected until Flush, then they are binned into tiles and the tiles
+// are rasterized in parallel. Every tile draws quads in their order,
+// so the result does not depend on the number of threads.
+class Canvas
+{
+public:
+    Canvas(int width, int height, size_t threads = 0);
+
+    // Fill the framebuffer and drop the collected quads
+    void Clear(uint32_t color);
+
+    // Matrix stack
+    void PushMatrix();
+    void PopMatrix();
+    void MatrixTranslate(float x, float y);
+    void MatrixRotate(float degrees);
+    void MatrixScale(float x, float y);
+
+    // Blending and color of the next quads
+    void SetBlend(BlendMode mode) { mBlend = mode; }
+    void SetColor(uint32_t color) { mColor = color; }
+
+    // Quad of the texture in the local coordinates. Null texture draws the color.
+    void DrawQuad(float x, float y, float width, float height, const Image* texture);
+
+    // Draw the texture with its size at the local origin
+    void DrawImage(const Image& texture);
+
+    // Rasterize all collected quads
+    void Flush();
+
+    // Framebuffer after the last flush
+    const Image& Frame() const { return mFrame; }
+
+    // 64-bit FNV-1a hash of the framebuffer, it is computed by pixels
+    uint64_t Hash() const;
+
+    // Write the framebuffer into the binary PPM file
+    bool WritePpm(const std::string& path) const;
+
+private:
+    Canvas(const Canvas&) = delete;
+    Canvas& operator=(const Canvas&) = delete;
+
+    // Collected quad
+    struct Quad
+    {
+        // Screen to local coordinates
+        Matrix mInverse;
+        float mX;
+        float mY;
+        float mWidth;
+        float mHeight;
+        const Image* mTexture;
+        uint32_t mColor;
+        BlendMode mBlend;
+        // Bounding box in pixels
+        int mMinX;
+        int mMinY;
+        int mMaxX;
+        int mMaxY;
+    };
+
+    // Rasterize the quads of the tile
+    void DrawTile(size_t tile);
+
+    Image mFrame;
+    std::vector<Matrix> mMatrices;
+    BlendMode mBlend;
+    uint32_t mColor;
+
+    std::vector<Quad> mQuads;
+
+    // Tiles of the framebuffer with the indexes of their quads
+    int mTilesX;
+    int mTilesY;
+    std::vector<std::vector<uint32_t>> mBins;
+
+    utils::WorkerPool mWorkers;
+};
+
+}
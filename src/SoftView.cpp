@@ -0,0 +1,150 @@
+/**
+ * \file
+ * \brief Implementation of the headless drawing of the salute
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "SoftView.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace weapons
+{
+
+namespace
+{
+
+// Colors of the procedural sprites
+const uint32_t SKY_COLOR = 0xFF0A1028;
+const uint32_t GUN_COLOR = 0xFF606870;
+const uint32_t ROCKET_COLOR = 0xFFD03020;
+const uint32_t SHOT_COLOR = 0xFFFFF0C0;
+
+// Size of the rocket sprite
+const int ROCKET_WIDTH = 6;
+const int ROCKET_HEIGHT = 20;
+// Size of the glow sprite
+const int GLOW_SIZE = 64;
+// Size of the sub-rocket spark
+const float SPARK_SIZE = 12.0f;
+
+// Glow sizes and lifetimes in seconds
+const float SHOT_GLOW_SIZE = 48.0f;
+const float SHOT_GLOW_TIME = 0.3f;
+const float BURST_GLOW_SIZE = 160.0f;
+const float BURST_GLOW_TIME = 1.5f;
+
+// Color of the salute effect
+uint32_t EffectColor(res::Handle effect)
+{
+    switch (effect)
+    {
+    case res::SALUTE_FIRST_HANDLE:
+        return 0xFFFFD040;
+    case res::SALUTE_SECOND_HANDLE:
+        return 0xFF40A0FF;
+    case res::SALUTE_THIRD_HANDLE:
+        return 0xFFFF40C0;
+    default:
+        return 0xFFFFFFFF;
+    }
+}
+
+}
+
+SoftView::SoftView(int gun_width, int gun_height)
+    : mGunImage(gun_width, gun_height, GUN_COLOR),
+    mRocketImage(ROCKET_WIDTH, ROCKET_HEIGHT, ROCKET_COLOR),
+    mGlowImage(GLOW_SIZE, GLOW_SIZE)
+{
+    // White glow with alpha, which falls from the center to the border
+    float radius = GLOW_SIZE / 2.0f;
+    for (int y = 0; y < GLOW_SIZE; y++)
+    {
+        for (int x = 0; x < GLOW_SIZE; x++)
+        {
+            float distance = std::hypot(x + 0.5f - radius, y + 0.5f - radius) / radius;
+            float intensity = std::max(0.0f, 1.0f - distance);
+            uint32_t alpha = static_cast<uint32_t>(255.0f * intensity * intensity);
+            mGlowImage.At(x, y) = (alpha << 24) | 0x00FFFFFF;
+        }
+    }
+}
+
+void SoftView::ApplyEvent(const WorldEvent& event, uint64_t tick)
+{
+    switch (event.mType)
+    {
+    case WorldEvent::SHOT:
+        mGlows.push_back({ event.mX, event.mY, SHOT_COLOR, SHOT_GLOW_SIZE, tick,
+                           static_cast<uint64_t>(SHOT_GLOW_TIME * SIMULATION_RATE) });
+        break;
+    case WorldEvent::BURST:
+        mGlows.push_back({ event.mX, event.mY, EffectColor(event.mResource), BURST_GLOW_SIZE, tick,
+                           static_cast<uint64_t>(BURST_GLOW_TIME * SIMULATION_RATE) });
+        break;
+    case WorldEvent::SHOW_AUDIO:
+        break;
+    }
+}
+
+void SoftView::Draw(const WorldSnapshot& snapshot, soft::Canvas& canvas)
+{
+    canvas.Clear(SKY_COLOR);
+    canvas.SetBlend(soft::BlendMode::ALPHA);
+    canvas.SetColor(0xFFFFFFFF);
+    for (int gun_x : snapshot.mGunX)
+    {
+        canvas.PushMatrix();
+        canvas.MatrixTranslate(static_cast<float>(gun_x), 0.0f);
+        canvas.DrawImage(mGunImage);
+        canvas.PopMatrix();
+    }
+
+    // Main rockets are drawn like in SaluteView, sub-rockets are sparks
+    for (auto& rocket : snapshot.mRockets)
+    {
+        if (!rocket.mMainRocket)
+            continue;
+
+        canvas.PushMatrix();
+        canvas.MatrixTranslate(rocket.mX, rocket.mY);
+        canvas.MatrixRotate(rocket.mAngle);
+        canvas.DrawQuad(-ROCKET_WIDTH / 2.0f, -ROCKET_HEIGHT / 2.0f,
+                        static_cast<float>(ROCKET_WIDTH), static_cast<float>(ROCKET_HEIGHT), &mRocketImage);
+        canvas.PopMatrix();
+    }
+
+    canvas.SetBlend(soft::BlendMode::ADD);
+    for (auto& rocket : snapshot.mRockets)
+    {
+        if (rocket.mMainRocket)
+            continue;
+
+        canvas.DrawQuad(rocket.mX - SPARK_SIZE / 2, rocket.mY - SPARK_SIZE / 2, SPARK_SIZE, SPARK_SIZE, &mGlowImage);
+    }
+
+    // Glows fade out during their lifetime
+    auto glow_end = std::remove_if(mGlows.begin(), mGlows.end(), [&snapshot](const Glow& glow)
+    {
+        return snapshot.mTick >= glow.mTick + glow.mLifetime;
+    });
+    mGlows.erase(glow_end, mGlows.end());
+    for (auto& glow : mGlows)
+    {
+        float age = static_cast<float>(snapshot.mTick - glow.mTick) / glow.mLifetime;
+        uint32_t alpha = static_cast<uint32_t>(255.0f * (1.0f - age));
+        float size = glow.mSize * (0.5f + 0.5f * age);
+        canvas.SetColor((alpha << 24) | (glow.mColor & 0x00FFFFFF));
+        canvas.DrawQuad(glow.mX - size / 2, glow.mY - size / 2, size, size, &mGlowImage);
+    }
+    canvas.SetColor(0xFFFFFFFF);
+    canvas.SetBlend(soft::BlendMode::ALPHA);
+    canvas.Flush();
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Headless drawing of the salute into the software canvas
+ * \author Maksimovskiy A.S.
+ */
+
+#include <vector>
+
+#include "SaluteGun.h"
+#include "SoftRender.h"
+
+
+namespace weapons
+{
+
+// Class sketches the world snapshot into the software canvas for the preview of the headless runs.
+// It is not SaluteView: textures and particle effects are replaced with procedural sprites,
+// the burst is an additive glow, which fades out.
+class SoftView
+{
+public:
+    SoftView(int gun_width, int gun_height);
+    ~SoftView() = default;
+
+    // Show the simulation event. Tick is the number of the current snapshot.
+    void ApplyEvent(const WorldEvent& event, uint64_t tick);
+
+    // Drawing the gun, rockets and glows of the snapshot
+    void Draw(const WorldSnapshot& snapshot, soft::Canvas& canvas);
+
+private:
+    // Glow of the shot or burst
+    struct Glow
+    {
+        float mX;
+        float mY;
+        uint32_t mColor;
+        float mSize;
+        // Snapshot tick of the event and lifetime in ticks
+        uint64_t mTick;
+        uint64_t mLifetime;
+    };
+
+    // Procedural sprites
+    soft::Image mGunImage;
+    soft::Image mRocketImage;
+    soft::Image mGlowImage;
+
+    // Glows, which are not faded yet
+    std::vector<Glow> mGlows;
+};
+
+}
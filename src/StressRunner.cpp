@@ -0,0 +1,704 @@
+/**
+ * \file
+ * \brief Implementation of the headless scenario runner and the simulation server
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "StressRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "AllocTracker.h"
+#include "Params.h"
+#include "SaveState.h"
+#include "SharedWorld.h"
+#include "Simulation.h"
+#include "SoftView.h"
+
+#if defined(ENGINE_TARGET_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+namespace stress
+{
+
+namespace
+{
+
+// Size of the gun without textures
+const int HEADLESS_GUN_SIZE = 100;
+// Allowed degradation against the baseline
+const double BASELINE_TOLERANCE = 0.1;
+// Seed of the simulation trace and the other fixed-seed runs
+const unsigned TRACE_SEED = 12345;
+// Difference of the seeds of the stress scenarios
+const unsigned STRESS_SEED_STEP = 7919;
+// Chain depth of the server and the shared memory test
+const int SERVER_DEPTH = 2;
+const int SHARED_TEST_DEPTH = 4;
+// Guns and allowed growth of the peak memory after the warm-up of the soak run
+const int SOAK_GUNS = 4;
+const size_t SOAK_MEMORY_GROWTH_KB = 1024;
+// Guns of the shared memory test
+const int SHARED_TEST_GUNS = 8;
+// Steps between the restarts of the show of the shared memory test
+const uint64_t SHARED_TEST_SHOW_TICKS = 30 * SIMULATION_RATE;
+// Shared memory of the test harness
+const char SHARED_TEST_NAME[] = "SaluteSharedTest";
+
+// Counters of the consumer of the shared memory test
+struct ConsumerStats
+{
+    // Frames, which passed the sequence check
+    uint64_t mFrames = 0;
+    // Frames, which were written during the reading
+    uint64_t mTorn = 0;
+    // Frames, which were replaced before the reading
+    uint64_t mMissed = 0;
+    // Frames with the wrong checksum or ticks out of order
+    uint64_t mErrors = 0;
+};
+
+// Read all new frames in place until the producer stops
+void ConsumeFrames(const std::atomic<bool>& done, ConsumerStats& stats)
+{
+    shm::WorldReader reader;
+    if (!reader.Open(SHARED_TEST_NAME))
+    {
+        ++stats.mErrors;
+        return;
+    }
+
+    uint64_t last_tick = 0;
+    while (!done.load(std::memory_order_acquire))
+    {
+        uint64_t latest = reader.LatestTick();
+        if (latest == last_tick)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint64_t first = std::max(last_tick + 1, latest >= shm::SHARED_SLOTS ? latest - shm::SHARED_SLOTS + 1 : 1);
+        stats.mMissed += first - last_tick - 1;
+        for (uint64_t tick = first; tick <= latest; tick++)
+        {
+            shm::SharedFrame frame;
+            if (!reader.Acquire(tick, frame))
+            {
+                ++stats.mTorn;
+                continue;
+            }
+
+            uint32_t checksum = shm::FrameChecksum(*frame.mSlot);
+            uint32_t written = frame.mSlot->mChecksum;
+            if (!reader.Validate(frame))
+            {
+                ++stats.mTorn;
+                continue;
+            }
+
+            ++stats.mFrames;
+            if (checksum != written || frame.mView.mTick != tick)
+                ++stats.mErrors;
+        }
+        last_tick = latest;
+    }
+}
+
+// FNV-1a hash of the simulation state, which is fed field by field, so the padding is not hashed
+class TraceHash
+{
+public:
+    template<typename T>
+    void Add(const T& value)
+    {
+        auto bytes = reinterpret_cast<const uint8_t*>(&value);
+        for (size_t i = 0; i < sizeof(T); i++)
+            mHash = (mHash ^ bytes[i]) * 0x100000001B3ull;
+    }
+
+    uint64_t Value() const { return mHash; }
+
+private:
+    uint64_t mHash = 0xCBF29CE484222325ull;
+};
+
+size_t PeakMemoryKb()
+{
+#if defined(ENGINE_TARGET_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+}
+
+float Percentile(std::vector<float>& values, float part)
+{
+    if (values.empty())
+        return 0.0f;
+
+    size_t idx = std::min(values.size() - 1, static_cast<size_t>(part * values.size()));
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values[idx];
+}
+
+ScenarioResult RunScenario(const ScenarioConfig& config,
+                           const Config::SettingType& difficulty,
+                           const Config::SettingType& salute_type,
+                           unsigned seed)
+{
+    using Clock = std::chrono::steady_clock;
+
+    weapons::Simulation simulation;
+    simulation.SetVirtualTime(true);
+    auto& battery = simulation.Battery();
+    battery.Init(config.mGuns, HEADLESS_GUN_SIZE, HEADLESS_GUN_SIZE, 0, Config::WinWidth(), seed);
+    battery.SetEffect(res::Registry::Instance().Register(salute_type.first));
+    battery.SetLevelLimit(utils::lexical_cast<int>(difficulty.first));
+    battery.SetFanOut(config.mFanOut);
+    if (!config.mStatePath.empty())
+    {
+        // The state brings its guns and rockets, the settings of the scenario are applied after it
+        weapons::Command command;
+        command.mType = weapons::Command::RESTORE_STATE;
+        command.mHandleCount = res::Registry::Instance().Count();
+        auto state = std::make_shared<std::vector<uint8_t>>();
+        if (save::ReadFile(config.mStatePath, *state))
+            command.mState = std::move(state);
+        else
+            Log::log.WriteError("Stress run: can not read the state " + config.mStatePath);
+        auto schedule = std::make_shared<show::ShowSchedule>();
+        if (schedule->Load(SHOW_FILE))
+            command.mShow = std::move(schedule);
+        simulation.Post(command);
+        simulation.Post(weapons::Command::SET_EFFECT, res::Registry::Instance().Register(salute_type.first));
+        simulation.Post(weapons::Command::SET_LEVEL_LIMIT, utils::lexical_cast<int>(difficulty.first));
+        simulation.Post(weapons::Command::SET_FAN_OUT, config.mFanOut);
+    }
+
+    ScenarioResult result;
+    result.mDifficulty = difficulty.second;
+    result.mSaluteType = salute_type.second;
+    result.mGuns = config.mGuns;
+    result.mSeed = seed;
+
+    utils::RandomGenerator rand(seed);
+    const float dt = 1.0f / SIMULATION_RATE;
+    int steps = static_cast<int>(config.mSeconds * SIMULATION_RATE);
+    int volley_steps = std::max(1, static_cast<int>(config.mVolleyPeriod * SIMULATION_RATE));
+    std::vector<float> step_times;
+    step_times.reserve(steps);
+    uint64_t simulated_rockets = 0;
+    double busy_seconds = 0.0;
+
+    // Shot timers of the gun use the virtual time, so the steps are not paced
+    weapons::WorldEvent event;
+    for (int step = 0; step < steps; step++)
+    {
+        if (step % volley_steps == 0)
+        {
+            // All shots of the volley are fired, the hand shot period would leave only the first one
+            for (int shot = 0; shot < config.mVolleySize; shot++)
+            {
+                weapons::Command command;
+                command.mForced = true;
+                if (rand.GetRealValue(0, 1) < config.mMouseShare)
+                {
+                    command.mType = weapons::Command::MOUSE_SHOT;
+                    command.mX = rand.GetIntValue(0, Config::WinWidth());
+                    command.mY = rand.GetIntValue(Config::WinHeight() / 2, Config::WinHeight());
+                }
+                else
+                {
+                    command.mType = weapons::Command::SHOT;
+                }
+                simulation.Post(command);
+            }
+        }
+
+        auto start_time = Clock::now();
+        simulation.Update(dt);
+        auto step_time = Clock::now() - start_time;
+        step_times.push_back(std::chrono::duration<float, std::micro>(step_time).count());
+        busy_seconds += std::chrono::duration<double>(step_time).count();
+
+        size_t live_rockets = simulation.Snapshot().mRockets.size();
+        simulated_rockets += live_rockets;
+        result.mPeakRockets = std::max(result.mPeakRockets, live_rockets);
+        while (simulation.PopEvent(event))
+        {
+        }
+    }
+
+    result.mRocketsPerSecond = busy_seconds > 0.0 ? simulated_rockets / busy_seconds : 0.0;
+    result.mStepP50 = Percentile(step_times, 0.5f);
+    result.mStepP99 = Percentile(step_times, 0.99f);
+    result.mStepMax = Percentile(step_times, 1.0f);
+    result.mAllocSteps = simulation.SteadyAllocSteps();
+    result.mPeakMemoryKb = PeakMemoryKb();
+    return result;
+}
+
+void WriteReport(const std::string& path, const std::vector<ScenarioResult>& results)
+{
+    std::ofstream out(path, std::ios::trunc);
+    out << "difficulty,salute_type,guns,rockets_per_sec,peak_rockets,step_p50_us,step_p99_us,step_max_us,"
+           "alloc_steps,peak_memory_kb,seed\n";
+    for (auto& result : results)
+        out << result.mDifficulty << ',' << result.mSaluteType << ',' << result.mGuns << ','
+            << result.mRocketsPerSecond << ',' << result.mPeakRockets << ',' << result.mStepP50 << ','
+            << result.mStepP99 << ',' << result.mStepMax << ',' << result.mAllocSteps << ','
+            << result.mPeakMemoryKb << ',' << result.mSeed << '\n';
+}
+
+std::vector<ScenarioResult> ReadReport(const std::string& path)
+{
+    std::vector<ScenarioResult> results;
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line))
+    {
+        std::istringstream row(line);
+        ScenarioResult result;
+        std::getline(row, result.mDifficulty, ',');
+        std::getline(row, result.mSaluteType, ',');
+        char comma;
+        row >> result.mGuns >> comma >> result.mRocketsPerSecond >> comma >> result.mPeakRockets >> comma
+            >> result.mStepP50 >> comma >> result.mStepP99 >> comma >> result.mStepMax >> comma
+            >> result.mAllocSteps >> comma >> result.mPeakMemoryKb;
+        if (!row)
+            continue;
+
+        // The reports without the seed column have the zero seed
+        if (!(row >> comma >> result.mSeed))
+            result.mSeed = 0;
+        results.push_back(result);
+    }
+    return results;
+}
+
+// Compare results with the baseline. Returns number of the regressions.
+int CompareWithBaseline(const std::vector<ScenarioResult>& results,
+                        const std::vector<ScenarioResult>& baseline)
+{
+    int regressions = 0;
+    for (auto& result : results)
+    {
+        auto base = std::find_if(baseline.begin(), baseline.end(), [&result](const ScenarioResult& item)
+        {
+            return item.mDifficulty == result.mDifficulty && item.mSaluteType == result.mSaluteType &&
+                   item.mGuns == result.mGuns;
+        });
+        if (base == baseline.end())
+            continue;
+
+        std::string scenario = result.mDifficulty + " / " + result.mSaluteType;
+        if (base->mSeed != result.mSeed)
+            Log::log.WriteWarn("Stress baseline of " + scenario + " was run with the seed " +
+                               std::to_string(base->mSeed) + ", the volleys differ");
+        if (result.mRocketsPerSecond < base->mRocketsPerSecond * (1.0 - BASELINE_TOLERANCE))
+        {
+            Log::log.WriteError("Stress regression in " + scenario + ": rockets per second " +
+                                std::to_string(result.mRocketsPerSecond) + " < " +
+                                std::to_string(base->mRocketsPerSecond));
+            ++regressions;
+        }
+        if (result.mStepP99 > base->mStepP99 * (1.0 + BASELINE_TOLERANCE))
+        {
+            Log::log.WriteError("Stress regression in " + scenario + ": step p99 " +
+                                std::to_string(result.mStepP99) + " us > " + std::to_string(base->mStepP99));
+            ++regressions;
+        }
+        if (result.mAllocSteps > base->mAllocSteps)
+        {
+            Log::log.WriteError("Stress regression in " + scenario + ": steady steps with allocations " +
+                                std::to_string(result.mAllocSteps));
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+}
+
+std::vector<ScenarioResult> RunAll(const ScenarioConfig& config)
+{
+    std::vector<ScenarioResult> results;
+    unsigned scenario = 0;
+    for (auto& difficulty : Config::Difficulty())
+        for (auto& salute_type : Config::SaluteTypes())
+            results.push_back(RunScenario(config, difficulty, salute_type, config.mSeed + STRESS_SEED_STEP * scenario++));
+    return results;
+}
+
+int RunFromArgs(int argc, const char* const* argv)
+{
+    ScenarioConfig config;
+    std::string baseline_path;
+    std::vector<std::string> values;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-baseline" && i + 1 < argc)
+            baseline_path = argv[++i];
+        else if (arg == "-guns" && i + 1 < argc)
+            config.mGuns = std::max(1, atoi(argv[++i]));
+        else if (arg == "-fanout" && i + 1 < argc)
+            config.mFanOut = atoi(argv[++i]);
+        else if (arg == "-state" && i + 1 < argc)
+            config.mStatePath = argv[++i];
+        else if (arg == "-seed" && i + 1 < argc)
+            config.mSeed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else
+            values.push_back(arg);
+    }
+    if (values.size() > 0)
+        config.mSeconds = static_cast<float>(atof(values[0].c_str()));
+    if (values.size() > 2)
+    {
+        config.mVolleyPeriod = static_cast<float>(atof(values[1].c_str()));
+        config.mVolleySize = atoi(values[2].c_str());
+    }
+
+    if (!memory::TRACK_ALLOCS)
+        Log::log.WriteWarn("Allocations are not tracked in this build, the steady steps are not checked");
+
+    auto results = RunAll(config);
+    WriteReport(Config::WriteDirectory() + "/stress_report.csv", results);
+
+    // Any steady step with allocations fails the run, with or without the baseline
+    int alloc_failures = 0;
+    for (auto& result : results)
+    {
+        if (!result.mAllocSteps)
+            continue;
+
+        Log::log.WriteError("Steady steps with allocations in " + result.mDifficulty + " / " + result.mSaluteType +
+                            ": " + std::to_string(result.mAllocSteps));
+        ++alloc_failures;
+    }
+    if (baseline_path.empty())
+        return alloc_failures ? 1 : 0;
+
+    return CompareWithBaseline(results, ReadReport(baseline_path)) || alloc_failures ? 1 : 0;
+}
+
+int RunSoakFromArgs(int argc, const char* const* argv)
+{
+    if (argc < 3)
+        return 1;
+
+    double hours = atof(argv[2]);
+    int guns = SOAK_GUNS;
+    int depth = SERVER_DEPTH;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-guns" && i + 1 < argc)
+            guns = std::max(1, atoi(argv[++i]));
+        else if (arg == "-depth" && i + 1 < argc)
+            depth = std::max(0, atoi(argv[++i]));
+    }
+
+    if (!memory::TRACK_ALLOCS)
+        Log::log.WriteWarn("Allocations are not tracked in this build, the steady steps are not checked");
+
+    weapons::Simulation simulation;
+    simulation.SetVirtualTime(true);
+    auto& battery = simulation.Battery();
+    battery.Init(guns, HEADLESS_GUN_SIZE, HEADLESS_GUN_SIZE, 0, Config::WinWidth(), TRACE_SEED);
+    battery.SetLevelLimit(depth);
+
+    const float dt = 1.0f / SIMULATION_RATE;
+    uint64_t steps = static_cast<uint64_t>(hours * 3600.0 * SIMULATION_RATE);
+    uint64_t shots = 0;
+    size_t peak_rockets = 0;
+    size_t warm_memory_kb = 0;
+    auto start_time = std::chrono::steady_clock::now();
+    weapons::WorldEvent event;
+    for (uint64_t step = 1; step <= steps; step++)
+    {
+        simulation.Update(dt);
+        while (simulation.PopEvent(event))
+        {
+            if (event.mType == weapons::WorldEvent::SHOT)
+                ++shots;
+        }
+        peak_rockets = std::max(peak_rockets, simulation.Snapshot().mRockets.size());
+        if (step == static_cast<uint64_t>(ALLOC_WARMUP_STEPS))
+            warm_memory_kb = PeakMemoryKb();
+    }
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    // Every gun fires when its timer reaches the shot period, the first time one period after the start
+    uint64_t expected_shots = guns * static_cast<uint64_t>(simulation.VirtualTime() / SHOT_PERIOD);
+    size_t memory_kb = PeakMemoryKb();
+    Log::log.WriteInfo("Soak run: " + std::to_string(simulation.VirtualTime()) + " s of the virtual time in " +
+                       std::to_string(wall_seconds) + " s, " + std::to_string(shots) + " shots of " +
+                       std::to_string(expected_shots) + ", peak " + std::to_string(peak_rockets) +
+                       " rockets, memory " + std::to_string(warm_memory_kb) + " KB after the warm-up, " +
+                       std::to_string(memory_kb) + " KB at the end, " +
+                       std::to_string(simulation.SteadyAllocSteps()) + " steps with allocations");
+
+    bool failed = shots != expected_shots || simulation.SteadyAllocSteps() ||
+                  (warm_memory_kb && memory_kb > warm_memory_kb + SOAK_MEMORY_GROWTH_KB);
+    return failed ? 1 : 0;
+}
+
+int RunServerFromArgs(int argc, const char* const* argv)
+{
+    if (argc < 3)
+        return 1;
+
+    std::string name = argv[2];
+    int guns = BATTERY_SIZE;
+    int depth = SERVER_DEPTH;
+    float seconds = 0.0f;
+    bool play_show = false;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-guns" && i + 1 < argc)
+            guns = std::min(std::max(1, atoi(argv[++i])), shm::SHARED_MAX_GUNS);
+        else if (arg == "-depth" && i + 1 < argc)
+            depth = std::max(0, atoi(argv[++i]));
+        else if (arg == "-seconds" && i + 1 < argc)
+            seconds = static_cast<float>(atof(argv[++i]));
+        else if (arg == "-show")
+            play_show = true;
+    }
+
+    shm::WorldWriter writer;
+    if (!writer.Create(name))
+        return 1;
+
+    weapons::Simulation simulation;
+    auto& battery = simulation.Battery();
+    battery.Init(guns, HEADLESS_GUN_SIZE, HEADLESS_GUN_SIZE, 0, Config::WinWidth(), static_cast<unsigned>(time(0)));
+    battery.SetEffect(res::Registry::Instance().Register(Config::SaluteTypes().back().first));
+    battery.SetLevelLimit(depth);
+    if (play_show)
+    {
+        auto schedule = std::make_shared<show::ShowSchedule>();
+        if (schedule->Load(SHOW_FILE))
+        {
+            weapons::Command command;
+            command.mType = weapons::Command::PLAY_SHOW;
+            command.mShow = schedule;
+            simulation.Post(command);
+        }
+        else
+            Log::log.WriteError("Server: no show " + SHOW_FILE);
+    }
+    Log::log.WriteInfo("Server: shared world " + name + ", " + std::to_string(guns) + " guns");
+
+    // Events, which do not fit into the frame, are sent with the next tick
+    std::vector<weapons::WorldEvent> events;
+    events.reserve(shm::SHARED_MAX_EVENTS);
+    const float dt = 1.0f / SIMULATION_RATE;
+    int steps = static_cast<int>(seconds * SIMULATION_RATE);
+    auto next_step = std::chrono::steady_clock::now();
+    weapons::WorldEvent event;
+    for (int step = 0; steps <= 0 || step < steps; step++)
+    {
+        simulation.Update(dt);
+        events.clear();
+        while (events.size() < shm::SHARED_MAX_EVENTS && simulation.PopEvent(event))
+            events.push_back(event);
+        writer.Publish(simulation.Snapshot(), events.data(), events.size());
+
+        next_step += std::chrono::microseconds(1000000 / SIMULATION_RATE);
+        std::this_thread::sleep_until(next_step);
+    }
+    return 0;
+}
+
+int RunSharedTestFromArgs(int argc, const char* const* argv)
+{
+    int consumers = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+    float seconds = argc > 3 ? static_cast<float>(atof(argv[3])) : 5.0f;
+
+    shm::WorldWriter writer;
+    if (!writer.Create(SHARED_TEST_NAME))
+        return 1;
+    writer.SetChecksums(true);
+
+    // Every consumer maps the memory by itself, as the renderer process does
+    std::atomic<bool> done(false);
+    std::vector<ConsumerStats> stats(consumers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < consumers; i++)
+        threads.emplace_back(ConsumeFrames, std::cref(done), std::ref(stats[i]));
+
+    // The producer is not paced, so the slots are rewritten while the consumers read them
+    weapons::Simulation simulation;
+    simulation.SetVirtualTime(true);
+    auto& battery = simulation.Battery();
+    battery.Init(SHARED_TEST_GUNS, HEADLESS_GUN_SIZE, HEADLESS_GUN_SIZE, 0, Config::WinWidth(), TRACE_SEED);
+    battery.SetLevelLimit(SHARED_TEST_DEPTH);
+    // The show is launched in the simulation time, so the frames are full of rockets
+    auto schedule = std::make_shared<show::ShowSchedule>();
+    weapons::Command show_command;
+    show_command.mType = weapons::Command::PLAY_SHOW;
+    if (schedule->Load(SHOW_FILE))
+        show_command.mShow = schedule;
+
+    std::vector<weapons::WorldEvent> events;
+    events.reserve(shm::SHARED_MAX_EVENTS);
+    const float dt = 1.0f / SIMULATION_RATE;
+    auto end_time = std::chrono::steady_clock::now() + std::chrono::duration<float>(seconds);
+    uint64_t ticks = 0;
+    weapons::WorldEvent event;
+    while (std::chrono::steady_clock::now() < end_time)
+    {
+        if (ticks % SHARED_TEST_SHOW_TICKS == 0 && show_command.mShow)
+            simulation.Post(show_command);
+        else if (ticks % SIMULATION_RATE == 0)
+            simulation.Post(weapons::Command::SHOT);
+        simulation.Update(dt);
+        events.clear();
+        while (events.size() < shm::SHARED_MAX_EVENTS && simulation.PopEvent(event))
+            events.push_back(event);
+        writer.Publish(simulation.Snapshot(), events.data(), events.size());
+        ++ticks;
+    }
+
+    done.store(true, std::memory_order_release);
+    for (auto& thread : threads)
+        thread.join();
+
+    int result = 0;
+    for (int i = 0; i < consumers; i++)
+    {
+        Log::log.WriteInfo("Shared memory test: consumer " + std::to_string(i) + " of " + std::to_string(ticks) +
+                           " ticks read " + std::to_string(stats[i].mFrames) + ", torn " +
+                           std::to_string(stats[i].mTorn) + ", missed " + std::to_string(stats[i].mMissed) +
+                           ", errors " + std::to_string(stats[i].mErrors));
+        if (stats[i].mErrors || !stats[i].mFrames)
+            result = 1;
+    }
+    return result;
+}
+
+int RunTraceFromArgs(int argc, const char* const* argv)
+{
+    if (argc < 4)
+        return 1;
+
+    int frames = atoi(argv[2]);
+    std::string trace_path = argv[3];
+    bool update = argc > 4 && std::string(argv[4]) == "-update";
+
+    auto schedule = std::make_shared<show::ShowSchedule>();
+    if (!schedule->Load(SHOW_FILE))
+    {
+        Log::log.WriteError("Trace run: no show " + SHOW_FILE);
+        return 1;
+    }
+
+    // The show is stepped with the fixed time and the shot timers take the virtual time,
+    // so the trace depends only on the seed, also after the show, when the auto shot is on again
+    weapons::Simulation simulation;
+    simulation.SetVirtualTime(true);
+    simulation.Battery().Init(BATTERY_SIZE, HEADLESS_GUN_SIZE, HEADLESS_GUN_SIZE, 0, Config::WinWidth(), TRACE_SEED);
+    weapons::Command command;
+    command.mType = weapons::Command::PLAY_SHOW;
+    command.mShow = schedule;
+    simulation.Post(command);
+
+    // The preview only sketches the last snapshot, the game view is not drawn by the trace
+    weapons::SoftView preview(HEADLESS_GUN_SIZE, HEADLESS_GUN_SIZE);
+    std::vector<uint64_t> hashes;
+    hashes.reserve(frames);
+    weapons::WorldEvent event;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        simulation.Update(1.0f / SIMULATION_RATE);
+        auto& snapshot = simulation.Snapshot();
+        TraceHash hash;
+        hash.Add(snapshot.mTick);
+        for (int gun_x : snapshot.mGunX)
+            hash.Add(gun_x);
+        for (auto& rocket : snapshot.mRockets)
+        {
+            hash.Add(rocket.mId);
+            hash.Add(rocket.mX);
+            hash.Add(rocket.mY);
+            hash.Add(rocket.mAngle);
+            hash.Add(rocket.mLevel);
+            hash.Add(rocket.mKind);
+            hash.Add(rocket.mMainRocket);
+        }
+        while (simulation.PopEvent(event))
+        {
+            hash.Add(event.mType);
+            hash.Add(event.mX);
+            hash.Add(event.mY);
+            hash.Add(event.mResource);
+            preview.ApplyEvent(event, snapshot.mTick);
+        }
+        hashes.push_back(hash.Value());
+    }
+
+    if (frames > 0)
+    {
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        soft::Canvas canvas(Config::WinWidth(), Config::WinHeight(), cores - 1);
+        preview.Draw(simulation.Snapshot(), canvas);
+        canvas.WritePpm(Config::WriteDirectory() + "/trace_last.ppm");
+    }
+    Log::log.WriteInfo("Trace run: peak population of the show " + std::to_string(simulation.LastShowPeak()) +
+                       " rockets");
+
+    if (update)
+    {
+        std::ofstream out(trace_path, std::ios::trunc);
+        for (auto hash : hashes)
+            out << std::hex << std::setw(16) << std::setfill('0') << hash << '\n';
+        return out ? 0 : 1;
+    }
+
+    std::ifstream in(trace_path);
+    std::vector<uint64_t> expected;
+    uint64_t hash = 0;
+    while (in >> std::hex >> hash)
+        expected.push_back(hash);
+    if (expected.size() != hashes.size())
+    {
+        Log::log.WriteError("Trace run: " + std::to_string(expected.size()) + " steps in " + trace_path +
+                            ", " + std::to_string(hashes.size()) + " steps were simulated");
+        return 1;
+    }
+
+    auto mismatch = std::mismatch(hashes.begin(), hashes.end(), expected.begin());
+    if (mismatch.first == hashes.end())
+        return 0;
+
+    Log::log.WriteError("Trace run: step " + std::to_string(mismatch.first - hashes.begin()) +
+                        " differs from " + trace_path);
+    return 1;
+}
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Headless scenario, simulation trace and simulation server runners for the salute simulation
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Params.h"
+
+
+namespace stress
+{
+
+// Settings of the scenario
+struct ScenarioConfig
+{
+    // Simulated time of every scenario in seconds
+    float mSeconds = 10.0f;
+    // Number of the guns in the battery
+    int mGuns = 1;
+    // Sub-rockets of one burst
+    int mFanOut = FAN_OUT;
+    // Period between volleys in seconds
+    float mVolleyPeriod = 1.0f;
+    // Shots in one volley
+    int mVolleySize = 4;
+    // Part of the mouse shots in the volley, others are gun shots
+    float mMouseShare = 0.5f;
+    // Seed of the run, every scenario gets its own seed from it, so the runs with the same seed
+    // play the same volleys
+    unsigned mSeed = 1;
+    // Saved state, which every scenario starts from, e.g. the middle of the show.
+    // Empty path means the empty sky.
+    std::string mStatePath;
+};
+
+// Results of one scenario
+struct ScenarioResult
+{
+    // Difficulty and salute type of the scenario
+    std::string mDifficulty;
+    std::string mSaluteType;
+    // Number of the guns in the battery
+    int mGuns = 1;
+    // Rockets simulated per second of the wall time
+    double mRocketsPerSecond = 0.0;
+    // Max number of the live rockets
+    size_t mPeakRockets = 0;
+    // Simulation step time percentiles in microseconds
+    float mStepP50 = 0.0f;
+    float mStepP99 = 0.0f;
+    float mStepMax = 0.0f;
+    // Steps after the warm-up with heap allocations
+    uint64_t mAllocSteps = 0;
+    // Peak memory of the process in KB
+    size_t mPeakMemoryKb = 0;
+    // Seed of the scenario
+    unsigned mSeed = 0;
+};
+
+// Run the scenario for every difficulty and salute type
+std::vector<ScenarioResult> RunAll(const ScenarioConfig& config);
+
+// Command line mode: -stress <seconds> [<volley period> <volley size>] [-guns <count>] [-fanout <count>]
+// [-state <saved state>] [-seed <value>] [-baseline <file>].
+// The scenarios run in the virtual time as fast as possible, the shots of the volley are not limited
+// by the hand shot period.
+// Writes the report into the write directory, returns non-zero if a scenario
+// is worse than the baseline.
+int RunFromArgs(int argc, const char* const* argv);
+
+// Command line mode: -soak <hours> [-guns <count>] [-depth <level>].
+// Auto fire of the guns for the hours of the virtual time without rendering. Returns non-zero
+// if the number of the shots differs from the shot period or the memory grows after the warm-up.
+int RunSoakFromArgs(int argc, const char* const* argv);
+
+// Command line mode: -server <name> [-guns <count>] [-depth <level>] [-seconds <time>] [-show].
+// Steps the simulation in real time without rendering and writes every tick into the shared memory
+// with the name, where the renderers in the client mode (-client <name>) read it.
+// Without the time the server runs until it is killed.
+int RunServerFromArgs(int argc, const char* const* argv);
+
+// Command line mode: -shmtest [<consumers> [<seconds>]].
+// One producer steps the simulation as fast as it can and writes the frames into the shared memory,
+// the consumers map it separately and read the frames in place. Returns non-zero if a consumer
+// took a frame, which passed the sequence check, but has the wrong checksum.
+int RunSharedTestFromArgs(int argc, const char* const* argv);
+
+// Command line mode: -trace <frames> <trace file> [-update].
+// Plays the show with the fixed seed, hashes the snapshot and the events of every step
+// and compares the hashes with the trace file or rewrites it. Only the simulation is checked,
+// the game view is not drawn. Returns non-zero if a step differs.
+int RunTraceFromArgs(int argc, const char* const* argv);
+
+}
@@ -0,0 +1,203 @@
+/**
+ * \file
+ * \brief Implementation of the rocket trails
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "TrailPool.h"
+
+#include <cmath>
+
+
+namespace weapons
+{
+
+namespace
+{
+
+// Colors of the trails by chain level without alpha
+const uint32_t TRAIL_COLORS[] = { 0xFFD080, 0xFF8040, 0xFF60A0, 0x80C0FF, 0xA0FF80 };
+const size_t TRAIL_COLOR_COUNT = sizeof(TRAIL_COLORS) / sizeof(TRAIL_COLORS[0]);
+
+// Rocket must move by this distance in pixels to add the new position
+const float TRAIL_MIN_STEP = 0.5f;
+
+// Number of the hash cells: power of two, which is at least twice the capacity
+size_t CellCount()
+{
+    size_t count = 1;
+    while (count < 2 * static_cast<size_t>(TRAIL_CAPACITY))
+        count <<= 1;
+    return count;
+}
+
+// Home cell of the rocket id
+size_t HomeCell(uint32_t id, size_t mask)
+{
+    return (id * 2654435761u) & mask;
+}
+
+}
+
+TrailPool::TrailPool()
+    : mSlots(TRAIL_CAPACITY),
+    mPoints(2 * TRAIL_CAPACITY * TRAIL_LENGTH),
+    mCells(CellCount(), 0),
+    mLive(0)
+{
+    mFreeSlots.reserve(TRAIL_CAPACITY);
+    for (int slot = TRAIL_CAPACITY - 1; slot >= 0; slot--)
+        mFreeSlots.push_back(slot);
+    mStrip.reserve(TRAIL_CAPACITY * (2 * TRAIL_LENGTH + 2));
+}
+
+int TrailPool::Acquire(uint32_t id)
+{
+    size_t cell = FindCell(id);
+    if (mCells[cell])
+        return mCells[cell] - 1;
+    if (mFreeSlots.empty())
+        return -1;
+
+    int slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    mSlots[slot] = Slot();
+    mSlots[slot].mId = id;
+    mSlots[slot].mLive = true;
+    mCells[cell] = slot + 1;
+    ++mLive;
+    return slot;
+}
+
+void TrailPool::AppendTrail(const Slot& slot, const float* points)
+{
+    const uint32_t mask = TRAIL_LENGTH - 1;
+    const uint32_t first = (slot.mHead - slot.mCount) & mask;
+    const uint32_t color = TRAIL_COLORS[slot.mLevel % TRAIL_COLOR_COUNT];
+    bool join = !mStrip.empty();
+    if (join)
+        mStrip.push_back(mStrip.back());
+
+    // From the oldest position to the newest one, the trail gets wider and brighter to the rocket
+    float normal_x = 0.0f;
+    float normal_y = 1.0f;
+    for (uint32_t i = 0; i < slot.mCount; i++)
+    {
+        const float* point = points + 2 * ((first + i) & mask);
+        const float* other = i + 1 < slot.mCount ? points + 2 * ((first + i + 1) & mask)
+                                                 : points + 2 * ((first + i - 1) & mask);
+        float dx = i + 1 < slot.mCount ? other[0] - point[0] : point[0] - other[0];
+        float dy = i + 1 < slot.mCount ? other[1] - point[1] : point[1] - other[1];
+        float length = std::sqrt(dx * dx + dy * dy);
+        if (length > 0.001f)
+        {
+            normal_x = -dy / length;
+            normal_y = dx / length;
+        }
+
+        float fade = (i + 1) / static_cast<float>(slot.mCount);
+        float half_width = 0.5f * TRAIL_WIDTH * fade;
+        uint32_t argb = (static_cast<uint32_t>(255.0f * fade) << 24) | color;
+        TrailVertex left = { point[0] + normal_x * half_width, point[1] + normal_y * half_width, argb };
+        TrailVertex right = { point[0] - normal_x * half_width, point[1] - normal_y * half_width, argb };
+        mStrip.push_back(left);
+        if (i == 0 && join)
+            mStrip.push_back(left);
+        mStrip.push_back(right);
+    }
+}
+
+const std::vector<TrailVertex>& TrailPool::BuildStrip()
+{
+    mStrip.clear();
+    for (size_t slot = 0; slot < mSlots.size(); slot++)
+        if (mSlots[slot].mLive && mSlots[slot].mCount >= 2)
+            AppendTrail(mSlots[slot], mPoints.data() + 2 * TRAIL_LENGTH * slot);
+    return mStrip;
+}
+
+void TrailPool::Clear()
+{
+    for (size_t slot = 0; slot < mSlots.size(); slot++)
+        if (mSlots[slot].mLive)
+            Release(FindCell(mSlots[slot].mId));
+}
+
+size_t TrailPool::FindCell(uint32_t id) const
+{
+    // The table is at most half full, so the empty cell is always found
+    const size_t mask = mCells.size() - 1;
+    size_t cell = HomeCell(id, mask);
+    while (mCells[cell] && mSlots[mCells[cell] - 1].mId != id)
+        cell = (cell + 1) & mask;
+    return cell;
+}
+
+void TrailPool::Release(size_t cell)
+{
+    int slot = mCells[cell] - 1;
+    mSlots[slot].mLive = false;
+    mFreeSlots.push_back(slot);
+    --mLive;
+
+    // Shift back the next cells of the probe sequence, so the table has no tombstones
+    const size_t mask = mCells.size() - 1;
+    size_t hole = cell;
+    for (size_t next = (hole + 1) & mask; mCells[next]; next = (next + 1) & mask)
+    {
+        size_t home = HomeCell(mSlots[mCells[next] - 1].mId, mask);
+        bool can_move = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (can_move)
+        {
+            mCells[hole] = mCells[next];
+            hole = next;
+        }
+    }
+    mCells[hole] = 0;
+}
+
+void TrailPool::Update(const SnapshotView& snapshot)
+{
+    // Rockets, which are not in the snapshot, were used. Their slots are freed first,
+    // so the new rockets can take them on this frame.
+    for (auto& rocket : snapshot.mRockets)
+    {
+        size_t cell = FindCell(rocket.mId);
+        if (mCells[cell])
+            mSlots[mCells[cell] - 1].mTick = snapshot.mTick;
+    }
+    for (size_t slot = 0; slot < mSlots.size(); slot++)
+        if (mSlots[slot].mLive && mSlots[slot].mTick != snapshot.mTick)
+            Release(FindCell(mSlots[slot].mId));
+
+    const uint32_t mask = TRAIL_LENGTH - 1;
+    for (auto& rocket : snapshot.mRockets)
+    {
+        int index = Acquire(rocket.mId);
+        if (index < 0)
+            continue;
+
+        auto& slot = mSlots[index];
+        slot.mTick = snapshot.mTick;
+        slot.mLevel = rocket.mLevel;
+        float* points = mPoints.data() + 2 * TRAIL_LENGTH * index;
+        if (slot.mCount)
+        {
+            const float* last = points + 2 * ((slot.mHead - 1) & mask);
+            float dx = rocket.mX - last[0];
+            float dy = rocket.mY - last[1];
+            if (dx * dx + dy * dy < TRAIL_MIN_STEP * TRAIL_MIN_STEP)
+                continue;
+        }
+
+        points[2 * slot.mHead] = rocket.mX;
+        points[2 * slot.mHead + 1] = rocket.mY;
+        slot.mHead = (slot.mHead + 1) & mask;
+        if (slot.mCount < TRAIL_LENGTH)
+            ++slot.mCount;
+    }
+}
+
+}
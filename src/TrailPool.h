@@ -0,0 +1,87 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Trails of the rockets in preallocated ring buffers
+ * \author Maksimovskiy A.S.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "Params.h"
+#include "SaluteGun.h"
+
+
+namespace weapons
+{
+
+// Vertex of the trail strip. Color is 0xAARRGGBB.
+struct TrailVertex
+{
+    float mX;
+    float mY;
+    uint32_t mColor;
+};
+
+// Pool of the trails: every rocket of the snapshot keeps its last TRAIL_LENGTH positions
+// in the ring buffer of its slot. All memory is allocated in the constructor,
+// rockets above TRAIL_CAPACITY are drawn without the trail.
+class TrailPool
+{
+    static_assert((TRAIL_LENGTH & (TRAIL_LENGTH - 1)) == 0, "Trail length must be a power of two");
+
+public:
+    TrailPool();
+
+    // Append positions of the rockets and free the trails of the used rockets
+    void Update(const SnapshotView& snapshot);
+
+    // Build one triangle strip for all trails. The trails are joined by degenerate triangles.
+    const std::vector<TrailVertex>& BuildStrip();
+
+    // Free all trails
+    void Clear();
+
+    // Number of the live trails
+    size_t Count() const { return mLive; }
+
+private:
+    // Slot of the trail. Positions are stored in the common array.
+    struct Slot
+    {
+        uint32_t mId = 0;
+        uint64_t mTick = 0;
+        // Index of the next position in the ring and the number of positions
+        uint32_t mHead = 0;
+        uint32_t mCount = 0;
+        uint8_t mLevel = 0;
+        // Live flag, free slots are kept in the free list
+        bool mLive = false;
+    };
+
+    // Index of the hash cell for the rocket id
+    size_t FindCell(uint32_t id) const;
+
+    // Slot of the rocket, new slot is taken from the free list. Returns -1 if the pool is full.
+    int Acquire(uint32_t id);
+
+    // Return the slot of the cell into the free list
+    void Release(size_t cell);
+
+    // Add the trail of the slot into the strip
+    void AppendTrail(const Slot& slot, const float* points);
+
+    std::vector<Slot> mSlots;
+    // Positions of all trails: TRAIL_LENGTH pairs of x and y for every slot
+    std::vector<float> mPoints;
+    // Free slots
+    std::vector<int> mFreeSlots;
+    // Open addressing table of the rocket ids: slot + 1, zero is the empty cell
+    std::vector<int> mCells;
+    // Strip of the last build
+    std::vector<TrailVertex> mStrip;
+    size_t mLive;
+};
+
+}
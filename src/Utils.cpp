@@ -2,24 +2,71 @@
 
 #include "Utils.h"
 
+#include <chrono>
 #include <ctime>
 #include <corecrt_math_defines.h>
+#include <fstream>
+
+#include "Params.h"
 
 
 namespace utils
 {
 
-RandomGenerator::RandomGenerator() :
-    mGen(time(0))
+RandomGenerator::RandomGenerator(unsigned seed) :
+    mGen(seed)
 {
 }
 
 RandomGenerator& RandomGenerator::Instance()
 {
-    static RandomGenerator rand_gen_instance;
+    static RandomGenerator rand_gen_instance(static_cast<unsigned>(time(0)));
     return rand_gen_instance;
 }
 
+//------------------------------------------------------------------------------------
+
+namespace
+{
+
+// Finalizer of SplitMix64
+uint64_t Mix(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+}
+
+CounterRandom::CounterRandom(uint64_t seed, uint64_t stream)
+    : mKey(Mix(Mix(seed) + stream * GOLDEN_GAMMA))
+{
+}
+
+uint64_t CounterRandom::Bits(uint32_t counter) const
+{
+    return Mix(mKey + (counter + 1) * GOLDEN_GAMMA);
+}
+
+int CounterRandom::GetIntValue(uint32_t counter, int min, int max) const
+{
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min + 1);
+    return min + static_cast<int>(((Bits(counter) >> 32) * range) >> 32);
+}
+
+float CounterRandom::GetRealValue(uint32_t counter, float min, float max) const
+{
+    // 24 bits fill the mantissa of the float
+    float unit = (Bits(counter) >> 40) * (1.0f / 16777216.0f);
+    return min + unit * (max - min);
+}
+
 int RandomGenerator::GetIntValue(int min, int max)
 {
     std::uniform_int_distribution<> urd(min, max);
@@ -32,6 +79,48 @@ float RandomGenerator::GetRealValue(int min, int max)
     return static_cast<float>(urd(mGen));
 }
 
+//------------------------------------------------------------------------------------
+// Clocks
+
+const WallClock& WallClock::Instance()
+{
+    static WallClock clock_instance;
+    return clock_instance;
+}
+
+double WallClock::Now() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ClockTimer::ClockTimer(const Clock* clock)
+    : mClock(clock),
+    mStartTime(clock->Now())
+{
+}
+
+void ClockTimer::SetClock(const Clock* clock)
+{
+    float elapsed = Elapsed();
+    mClock = clock;
+    SetElapsed(elapsed);
+}
+
+void ClockTimer::Start()
+{
+    mStartTime = mClock->Now();
+}
+
+float ClockTimer::Elapsed() const
+{
+    return static_cast<float>(mClock->Now() - mStartTime);
+}
+
+void ClockTimer::SetElapsed(float elapsed)
+{
+    mStartTime = mClock->Now() - elapsed;
+}
+
 //------------------------------------------------------------------------------------
 
 CosSinCalc::CosSinCalc()
@@ -91,11 +180,10 @@ Rect::Rect(int x, int y, int height, int width)
 
 //------------------------------------------------------------------------------------
 
-void DrawTexture(const std::string& texture)
+void DrawTexture(Render::Texture* texture)
 {
-    Render::Texture* win = Core::resourceManager.Get<Render::Texture>(texture);
     Render::device.PushMatrix();
-    win->Draw();
+    texture->Draw();
     Render::device.PopMatrix();
 }
 
@@ -131,4 +219,18 @@ Render::Texture* GetTexture(const std::string& name)
     return Core::resourceManager.Get<Render::Texture>(name);
 }
 
+//------------------------------------------------------------------------------------
+
+bool ReadGameFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    std::ifstream file(Config::BaseDirectory() + "/" + path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    auto size = static_cast<size_t>(file.tellg());
+    data.resize(size);
+    file.seekg(0);
+    return size == 0 || static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
 }
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <random>
 #include <list>
+#include <string>
+#include <vector>
 
 
 namespace utils
@@ -12,9 +17,12 @@ namespace utils
 class RandomGenerator
 {
 public:
-    // Instance
+    // Instance. It must be used only from one thread.
     static RandomGenerator& Instance();
 
+    // Own generator, e.g. for the thread
+    explicit RandomGenerator(unsigned seed);
+
     // Generating integers from min to max
     int GetIntValue(int min, int max);
 
@@ -24,11 +32,103 @@ private:
     // Parameter for the distribution function
     std::mt19937 mGen;
 
-    RandomGenerator();
     RandomGenerator(const RandomGenerator&) = delete;
     RandomGenerator& operator=(RandomGenerator&) = delete;
 };
 
+//------------------------------------------------------------------------------------
+// Counter-based random numbers: the value depends only on the seed, the stream and
+// the counter, so the streams can be used in any order and from any thread.
+class CounterRandom
+{
+public:
+    CounterRandom(uint64_t seed, uint64_t stream);
+
+    // Integer from min to max for the counter
+    int GetIntValue(uint32_t counter, int min, int max) const;
+
+    // Real number from min to max for the counter
+    float GetRealValue(uint32_t counter, float min, float max) const;
+
+private:
+    // Random 64 bits for the counter
+    uint64_t Bits(uint32_t counter) const;
+
+    uint64_t mKey;
+};
+
+//------------------------------------------------------------------------------------
+// Source of the time in seconds for the timers of the simulation
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+
+    // Current time
+    virtual double Now() const = 0;
+};
+
+// Monotonic wall clock
+class WallClock : public Clock
+{
+public:
+    // Instance
+    static const WallClock& Instance();
+
+    double Now() const override;
+};
+
+// Simulated time, which is advanced by the simulation step,
+// so the hours of the simulation take as much time as the steps need
+class VirtualClock : public Clock
+{
+public:
+    double Now() const override { return mTime; }
+
+    // Move the time forward
+    void Advance(double dt) { mTime += dt; }
+
+private:
+    double mTime = 0.0;
+};
+
+// Timer on the clock, which can be changed. It counts the time from the last start.
+class ClockTimer
+{
+public:
+    explicit ClockTimer(const Clock* clock = &WallClock::Instance());
+
+    // Take the time from the clock, the elapsed time is kept
+    void SetClock(const Clock* clock);
+
+    // Count the time from now
+    void Start();
+
+    // Time from the last start
+    float Elapsed() const;
+
+    // Count the time, so the elapsed time is equal to the value
+    void SetElapsed(float elapsed);
+
+private:
+    const Clock* mClock;
+    double mStartTime;
+};
+
+//------------------------------------------------------------------------------------
+// Read-only range of the array, which is owned by somebody else
+template<typename T>
+struct ArrayRange
+{
+    const T* mBegin = nullptr;
+    const T* mEnd = nullptr;
+
+    const T* begin() const { return mBegin; }
+    const T* end() const { return mEnd; }
+    size_t size() const { return mEnd - mBegin; }
+    bool empty() const { return mBegin == mEnd; }
+};
+
 //------------------------------------------------------------------------------------
 // Class for loop iteration.
 template<typename T>
@@ -71,7 +171,18 @@ public:
         --mElementListIt;
     }
     
-    T Value(){ return *mElementListIt; }
+    // Move to the first element, which satisfies the predicate. Returns false if there is no such element.
+    template<typename Pred>
+    bool Select(Pred pred)
+    {
+        auto found = std::find_if(mElementList.begin(), mElementList.end(), pred);
+        if (found == mElementList.end())
+            return false;
+        mElementListIt = found;
+        return true;
+    }
+
+    const T& Value() const { return *mElementListIt; }
     
     List& GetList(){ return mElementList; }
 };
@@ -117,7 +228,7 @@ struct Rect
 
 //------------------------------------------------------------------------------------
 // Method to draw texture
-void DrawTexture(const std::string& texture);
+void DrawTexture(Render::Texture* texture);
 
 // Method to get texture
 Render::Texture* GetTexture(const std::string& name);
@@ -128,5 +239,8 @@ int InitSize(Render::Texture* tex, float& delta_x, float& delta_y);
 // Method for calculating the angle between vectors
 float VectorsAngle(float x1, float x2, float x3, float x4);
 
+// Read the whole file of the game directory (Config::BaseDirectory) by its relative path
+bool ReadGameFile(const std::string& path, std::vector<uint8_t>& data);
+
 
 }
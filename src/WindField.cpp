@@ -0,0 +1,188 @@
+/**
+ * \file
+ * \brief Implementation of the wind field
+ * \author Maksimovskiy A.S.
+ */
+
+#include "stdafx.h"
+
+#include "WindField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "Params.h"
+#include "Utils.h"
+
+
+namespace weapons
+{
+
+namespace
+{
+
+const float TWO_PI = 6.2831853f;
+
+// Read the layer of the grid. Rows in the text go from the top.
+bool ReadLayer(std::istream& input, int columns, int rows, std::vector<float>& layer_x,
+               std::vector<float>& layer_y, int& line_number)
+{
+    layer_x.assign(columns * rows, 0.0f);
+    layer_y.assign(columns * rows, 0.0f);
+    std::string line;
+    for (int row = rows - 1; row >= 0; )
+    {
+        if (!std::getline(input, line))
+            return false;
+        ++line_number;
+        line.erase(std::min(line.size(), line.find('#')));
+        std::istringstream fields(line);
+        int column = 0;
+        float x = 0.0f;
+        float y = 0.0f;
+        while (column < columns && fields >> x >> y)
+        {
+            layer_x[row * columns + column] = x;
+            layer_y[row * columns + column] = y;
+            ++column;
+        }
+        if (column == 0)
+            continue;
+        if (column != columns)
+            return false;
+        --row;
+    }
+    return true;
+}
+
+}
+
+void WindField::Animate(float time)
+{
+    if (IsCalm())
+        return;
+
+    float gust = std::sin(TWO_PI * time / mPeriod);
+    for (size_t i = 0; i < mCurrentX.size(); i++)
+    {
+        mCurrentX[i] = mBaseX[i] + gust * mGustX[i];
+        mCurrentY[i] = mBaseY[i] + gust * mGustY[i];
+    }
+}
+
+bool WindField::Load(const std::string& city)
+{
+    std::vector<uint8_t> data;
+    if (!utils::ReadGameFile("wind/" + city + ".txt", data))
+        return false;
+
+    int error_line = 0;
+    if (!Parse(reinterpret_cast<const char*>(data.data()), data.size(), error_line))
+    {
+        Log::log.WriteError("Wind of " + city + ": error in line " + std::to_string(error_line));
+        return false;
+    }
+    return true;
+}
+
+bool WindField::Parse(const char* text, size_t size, int& error_line)
+{
+    // grid <columns> <rows> period <seconds>
+    // base
+    // <rows of "x y" pairs from the top>
+    // gust
+    // <rows of "x y" pairs from the top>
+    mCurrentX.clear();
+    mCurrentY.clear();
+    std::istringstream input(std::string(text, size));
+    std::string line;
+    std::string key;
+    error_line = 0;
+    bool has_base = false;
+    bool has_gust = false;
+    while (std::getline(input, line))
+    {
+        ++error_line;
+        line.erase(std::min(line.size(), line.find('#')));
+        std::istringstream fields(line);
+        if (!(fields >> key))
+            continue;
+
+        if (key == "grid")
+        {
+            std::string period_key;
+            if (!(fields >> mColumns >> mRows >> period_key >> mPeriod) || period_key != "period" ||
+                mColumns < 2 || mRows < 2 || mPeriod <= 0.0f)
+                return false;
+        }
+        else if (key == "base" && mColumns)
+        {
+            if (!ReadLayer(input, mColumns, mRows, mBaseX, mBaseY, error_line))
+                return false;
+            has_base = true;
+        }
+        else if (key == "gust" && mColumns)
+        {
+            if (!ReadLayer(input, mColumns, mRows, mGustX, mGustY, error_line))
+                return false;
+            has_gust = true;
+        }
+        else
+            return false;
+    }
+    if (!has_base)
+        return false;
+
+    if (!has_gust)
+    {
+        mGustX.assign(mBaseX.size(), 0.0f);
+        mGustY.assign(mBaseY.size(), 0.0f);
+    }
+    mScaleX = (mColumns - 1) / static_cast<float>(Config::WinWidth());
+    mScaleY = (mRows - 1) / static_cast<float>(Config::WinHeight());
+    mCurrentX = mBaseX;
+    mCurrentY = mBaseY;
+    return true;
+}
+
+void WindField::Sample(float x, float y, float& wind_x, float& wind_y) const
+{
+    SampleBatch(&x, &y, &wind_x, &wind_y, 1);
+}
+
+void WindField::SampleBatch(const float* x, const float* y, float* wind_x, float* wind_y, size_t count) const
+{
+    if (IsCalm())
+    {
+        std::fill(wind_x, wind_x + count, 0.0f);
+        std::fill(wind_y, wind_y + count, 0.0f);
+        return;
+    }
+
+    // Points out of the window take the wind of the border
+    const float max_x = mColumns - 1.001f;
+    const float max_y = mRows - 1.001f;
+    const float* nodes_x = mCurrentX.data();
+    const float* nodes_y = mCurrentY.data();
+    for (size_t i = 0; i < count; i++)
+    {
+        float grid_x = std::min(std::max(x[i] * mScaleX, 0.0f), max_x);
+        float grid_y = std::min(std::max(y[i] * mScaleY, 0.0f), max_y);
+        int column = static_cast<int>(grid_x);
+        int row = static_cast<int>(grid_y);
+        float tx = grid_x - column;
+        float ty = grid_y - row;
+        int node = row * mColumns + column;
+
+        float bottom_x = nodes_x[node] + tx * (nodes_x[node + 1] - nodes_x[node]);
+        float top_x = nodes_x[node + mColumns] + tx * (nodes_x[node + mColumns + 1] - nodes_x[node + mColumns]);
+        wind_x[i] = bottom_x + ty * (top_x - bottom_x);
+
+        float bottom_y = nodes_y[node] + tx * (nodes_y[node + 1] - nodes_y[node]);
+        float top_y = nodes_y[node + mColumns] + tx * (nodes_y[node + mColumns + 1] - nodes_y[node + mColumns]);
+        wind_y[i] = bottom_y + ty * (top_y - bottom_y);
+    }
+}
+
+}
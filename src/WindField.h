@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Wind field on a coarse grid over the window
+ * \author Maksimovskiy A.S.
+ */
+
+#include <string>
+#include <vector>
+
+
+namespace weapons
+{
+
+// Wind vectors in the nodes of the grid, which covers the window.
+// Wind of the node is base + gust * sin(2 * pi * time / period).
+// The current grid is calculated once per step, then it is sampled
+// with bilinear interpolation by any number of threads.
+class WindField
+{
+public:
+    WindField() = default;
+
+    // Load the wind of the city from "wind/<city>.txt"
+    bool Load(const std::string& city);
+
+    // Parse the text wind. Returns false and the line number on error.
+    bool Parse(const char* text, size_t size, int& error_line);
+
+    // Check that there is no wind
+    bool IsCalm() const { return mCurrentX.empty(); }
+
+    // Calculate the current grid for the time in seconds
+    void Animate(float time);
+
+    // Current wind in the point
+    void Sample(float x, float y, float& wind_x, float& wind_y) const;
+
+    // Current wind in the points of the batch
+    void SampleBatch(const float* x, const float* y, float* wind_x, float* wind_y, size_t count) const;
+
+private:
+    // Grid size in nodes
+    int mColumns = 0;
+    int mRows = 0;
+    // Window to grid scale
+    float mScaleX = 0.0f;
+    float mScaleY = 0.0f;
+    // Period of the gusts in seconds
+    float mPeriod = 1.0f;
+
+    // Nodes by rows from the bottom
+    std::vector<float> mBaseX;
+    std::vector<float> mBaseY;
+    std::vector<float> mGustX;
+    std::vector<float> mGustY;
+    std::vector<float> mCurrentX;
+    std::vector<float> mCurrentY;
+};
+
+}